@@ -0,0 +1,42 @@
+#pragma once
+
+
+#include <cstdio>
+#include <iostream>
+
+#include <ufmt/async_print.hpp>
+#include <ufmt/print.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    inline void async_print_threads() {
+        constexpr auto lines_per_thread = 100000u;
+
+        std::cout << "threads    ufmt::print (lines/s)    async_printer (lines/s)\n";
+        for(auto threads = 1u; threads <= 16u; threads *= 4) {
+            double sync, async;
+            {
+                silenced_stdout silenced;
+                sync = lines_per_second(threads, lines_per_thread, [](unsigned t, unsigned n) {
+                    for(auto i = 0u; i != n; ++i)
+                        ufmt::print("thread ", t, ", line ", i, ", value ", -127562.127562);
+                });
+                ufmt::async_printer printer;
+                async = lines_per_second(threads, lines_per_thread, [&](unsigned t, unsigned n) {
+                    for(auto i = 0u; i != n; ++i)
+                        printer.print("thread ", t, ", line ", i, ", value ", -127562.127562);
+                    printer.flush();
+                });
+            }
+            char line[128];
+            std::snprintf(line, sizeof(line), "%7u    %21.0f    %23.0f\n", threads, sync, async);
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+
+} // namespace bench
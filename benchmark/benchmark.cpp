@@ -8,6 +8,28 @@
 #include <ufmt/text.hpp>
 
 #include "ubench.hpp"
+#include "async_print.bench.hpp"
+#include "binary.bench.hpp"
+#include "buffered_file.bench.hpp"
+#include "datagram_sink.bench.hpp"
+#include "direct_text_file.bench.hpp"
+#include "durable_text_file.bench.hpp"
+#include "flight_recorder.bench.hpp"
+#include "log.bench.hpp"
+#include "mapped_text_file.bench.hpp"
+#include "memfd_sink.bench.hpp"
+#include "ordered_print.bench.hpp"
+#include "parallel_text_file.bench.hpp"
+#include "pipe_printer.bench.hpp"
+#include "print.bench.hpp"
+#include "printer.bench.hpp"
+#include "rate_limit.bench.hpp"
+#include "shared_text.bench.hpp"
+#include "sink.bench.hpp"
+#include "spinlock.bench.hpp"
+#include "text_file.bench.hpp"
+#include "text_pool.bench.hpp"
+#include "uring_text_file.bench.hpp"
 
 
 int main() {
@@ -104,5 +126,28 @@ int main() {
          << fmt_format << '\n';
     cout << endl;
 
+    bench::binary_print();
+    bench::disabled_log();
+    bench::suppressed_print();
+    bench::print_threads();
+    bench::async_print_threads();
+    bench::ordered_print_threads();
+    bench::printer_bursts();
+    bench::spinlock_threads();
+    bench::text_file_batches();
+    bench::buffered_file_lines();
+    bench::uring_file_lines();
+    bench::mapped_file_lines();
+    bench::direct_file_lines();
+    bench::durable_records();
+    bench::parallel_file_threads();
+    bench::sink_fan_out();
+    bench::flight_recorder_records();
+    bench::text_pool_handoff();
+    bench::shared_text_batch();
+    bench::pipe_printer_lines();
+    bench::memfd_report();
+    bench::datagram_lines();
+
     return 0;
 }
@@ -0,0 +1,36 @@
+#pragma once
+
+
+#include <iostream>
+#include <system_error>
+
+#include <ufmt/binary.hpp>
+
+#include "ubench.hpp"
+
+
+namespace bench {
+
+
+    inline void binary_print() {
+        std::error_code ec;
+        auto log = ufmt::binary_log::create_always("/dev/null", ec);
+        if(!log)
+            return;
+        ufmt::binary_writer writer{*log};
+        ufmt::text text;
+
+        auto const texter = ubench::run([&] {
+            text.clear();
+            text.format("nums: ", -1, ", ", -2, ", value: ", -127562.127562, '\n');
+        });
+        auto const binary = ubench::run([&] {
+            UFMT_BINARY_PRINT(writer, "nums: ", -1, ", ", -2, ", value: ", -127562.127562);
+        });
+
+        std::cout << "text.format(nums, double)          - " << texter << '\n';
+        std::cout << "UFMT_BINARY_PRINT(nums, double)    - " << binary << '\n';
+        std::cout << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,93 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include <ufmt/buffered_file.hpp>
+
+
+namespace bench {
+
+
+    // Formats into a text and copies it into the stdio buffer, as buffered_file used to
+    inline void stdio_print(std::FILE* file, ufmt::text& text, unsigned i) {
+        text.clear();
+        text.format("line ", i, ", value ", -127562.127562, '\n');
+        fwrite_unlocked(text.data(), sizeof(char), text.size(), file);
+    }
+
+
+    template<typename F>
+    double file_lines_per_second(unsigned lines, F&& f) {
+        using namespace std::chrono;
+        auto const started = steady_clock::now();
+        for(auto i = 0u; i != lines; ++i)
+            f(i);
+        return lines / duration<double>(steady_clock::now() - started).count();
+    }
+
+
+    inline void buffered_file_lines() {
+        constexpr auto lines = 2000000u;
+        auto const path = std::string{"ufmt-buffered_file.bench.log"};
+
+        double stdio, buffered, buffered_string;
+        {
+            auto* file = std::fopen(path.data(), "wb");
+            ufmt::text text;
+            stdio = file_lines_per_second(lines, [&](unsigned i) { stdio_print(file, text, i); });
+            std::fclose(file);
+        }
+        {
+            std::error_code ec;
+            auto file = ufmt::buffered_file<>::create_always(path, ec);
+            buffered = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        {
+            std::error_code ec;
+            auto file = ufmt::buffered_file<ufmt::text>::create_always(path, ec);
+            buffered_string = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        double behind[2];
+        std::uint64_t stalls[2];
+        double stalled[2];
+        for(auto n: {2u, 4u}) {
+            std::error_code ec;
+            auto file = ufmt::buffered_file<>::create_always(path, ec, 1 << 20, n);
+            auto const k = n == 2 ? 0 : 1;
+            behind[k] = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+            file->close();
+            stalls[k] = file->stalls();
+            stalled[k] = std::chrono::duration<double, std::milli>(file->stall_time()).count();
+        }
+        std::remove(path.data());
+
+        char line[128];
+        std::cout << "file output                      lines/s\n";
+        std::snprintf(line, sizeof(line), "text + fwrite_unlocked           %.0f\n", stdio);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "buffered_file<aligned_text>      %.0f\n", buffered);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "buffered_file<text>              %.0f\n", buffered_string);
+        std::cout << line;
+        for(auto k = 0; k != 2; ++k) {
+            std::snprintf(line, sizeof(line),
+                          "write-behind 1 MiB x %d           %.0f (%llu stalls, %.1f ms)\n",
+                          k == 0 ? 2 : 4, behind[k], (unsigned long long)stalls[k], stalled[k]);
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,77 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <system_error>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ufmt/datagram_sink.hpp>
+
+
+namespace bench {
+
+
+    // Lines to a local log collector draining with recvmmsg: one send(2)
+    // per line or datagram_sink gathering 32 lines per sendmmsg(2)
+    inline void datagram_lines() {
+        constexpr auto lines = 500000u;
+        using namespace std::chrono;
+
+        auto const measure = [&](auto&& send_lines) {
+            int pair[2];
+            ::socketpair(AF_UNIX, SOCK_DGRAM, 0, pair);
+            std::thread collector{[&] {
+                constexpr auto batch = 64u;
+                static char datagrams[batch][512];
+                ::iovec buffers[batch];
+                ::mmsghdr messages[batch] = {};
+                for(auto i = 0u; i != batch; ++i) {
+                    buffers[i] = ::iovec{datagrams[i], sizeof(datagrams[i])};
+                    messages[i].msg_hdr.msg_iov = &buffers[i];
+                    messages[i].msg_hdr.msg_iovlen = 1;
+                }
+                for(auto received = 0u; received != lines;) {
+                    auto const n = ::recvmmsg(pair[1], messages, batch, MSG_WAITFORONE, nullptr);
+                    if(n > 0)
+                        received += unsigned(n);
+                }
+            }};
+            auto const started = steady_clock::now();
+            send_lines(pair[0]);
+            collector.join();
+            auto const elapsed = duration<double>(steady_clock::now() - started).count();
+            ::close(pair[1]);
+            return lines / elapsed / 1e6;
+        };
+
+        auto const one_by_one = measure([](int fd) {
+            ufmt::text line;
+            for(auto i = 0u; i != lines; ++i) {
+                line.clear();
+                line.format("line ", i, ", value ", -127562.127562);
+                ::send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+            }
+            ::close(fd);
+        });
+
+        auto const batched = measure([](int fd) {
+            ufmt::datagram_sink sink{fd, {.batch = 32}};
+            for(auto i = 0u; i != lines; ++i)
+                sink.print("line ", i, ", value ", -127562.127562);
+        });
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "datagrams to local collector     Mlines/s\n");
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "send per line                    %.2f\n", one_by_one);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "datagram_sink, sendmmsg of 32    %.2f\n", batched);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
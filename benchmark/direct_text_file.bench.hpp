@@ -0,0 +1,80 @@
+#pragma once
+
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ufmt/buffered_file.hpp>
+#include <ufmt/direct_text_file.hpp>
+
+#include "buffered_file.bench.hpp"
+
+
+namespace bench {
+
+
+    // Share of the file pages present in the page cache
+    inline double cached_share(std::string const& path) {
+        auto const fd = ::open(path.data(), O_RDONLY);
+        struct ::stat info;
+        if(fd == -1 || ::fstat(fd, &info) == -1 || info.st_size == 0)
+            return 0.;
+        auto const page = std::size_t(::sysconf(_SC_PAGESIZE));
+        auto const pages = (std::size_t(info.st_size) + page - 1) / page;
+        auto* mapped = ::mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        std::vector<unsigned char> resident(pages);
+        ::mincore(mapped, std::size_t(info.st_size), resident.data());
+        std::size_t cached = 0;
+        for(auto r: resident)
+            cached += r & 1;
+        ::munmap(mapped, std::size_t(info.st_size));
+        ::close(fd);
+        return double(cached) / double(pages);
+    }
+
+
+    inline void direct_file_lines() {
+        constexpr auto lines = 4000000u;
+        auto const path = std::string{"ufmt-direct_text_file.bench.log"};
+        std::error_code ec;
+
+        double buffered, direct, buffered_cached, direct_cached;
+        bool bypassed;
+        {
+            auto file = ufmt::buffered_file<>::create_always(path, ec, 1 << 20);
+            buffered = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        buffered_cached = cached_share(path);
+        std::remove(path.data());
+        {
+            auto file = ufmt::direct_text_file::create_always(path, ec);
+            bypassed = file->direct();
+            direct = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        direct_cached = cached_share(path);
+        std::remove(path.data());
+
+        char line[128];
+        std::cout << "bulk file output                 lines/s       page cache\n";
+        std::snprintf(line, sizeof(line), "buffered_file (1 MiB)            %-12.0f  %.0f%%\n",
+                      buffered, buffered_cached * 100.);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "%-33s%-12.0f  %.0f%%\n",
+                      bypassed ? "direct_text_file (O_DIRECT)" : "direct_text_file (no O_DIRECT)",
+                      direct, direct_cached * 100.);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,56 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include <ufmt/durable_text_file.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    inline void durable_records() {
+        constexpr auto records = 2000u;
+        auto const path = std::string{"ufmt-durable_text_file.bench.log"};
+        std::error_code ec;
+
+        double per_line;
+        {
+            auto const fd = ::open(path.data(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+            ufmt::text line;
+            per_line = lines_per_second(1, records / 4, [&](unsigned, unsigned n) {
+                for(auto i = 0u; i != n; ++i) {
+                    line.clear();
+                    line.format("record ", i, ", value ", -127562.127562, '\n');
+                    ::write(fd, line.data(), line.size());
+                    ::fdatasync(fd);
+                }
+            });
+            ::close(fd);
+        }
+
+        std::cout << "threads    write+fdatasync (records/s)    group commit (records/s)    commits\n";
+        for(auto threads = 1u; threads <= 16u; threads *= 4) {
+            auto file = ufmt::durable_text_file::create_always(path, ec);
+            auto const grouped = lines_per_second(threads, records / threads, [&](unsigned t, unsigned n) {
+                for(auto i = 0u; i != n; ++i)
+                    file->print_durable("record ", t, ':', i, ", value ", -127562.127562);
+            });
+            char row[128];
+            std::snprintf(row, sizeof(row), "%-10u %-30.0f %-27.0f %llu\n",
+                          threads, per_line, grouped, (unsigned long long)file->commits());
+            std::cout << row;
+        }
+        std::cout << std::endl;
+        std::remove(path.data());
+    }
+
+} // namespace bench
@@ -0,0 +1,58 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <system_error>
+
+#include <ufmt/buffered_file.hpp>
+#include <ufmt/flight_recorder.hpp>
+
+
+namespace bench {
+
+
+    template<typename F>
+    double recorder_ns_per_record(unsigned records, F&& f) {
+        using namespace std::chrono;
+        auto const started = steady_clock::now();
+        for(auto i = 0u; i != records; ++i)
+            f(i);
+        return duration<double, std::nano>(steady_clock::now() - started).count() / records;
+    }
+
+
+    // Cost of keeping the last records in shared memory
+    inline void flight_recorder_records() {
+        constexpr auto records = 2000000u;
+        std::error_code ec;
+        auto recorder = ufmt::flight_recorder::create("ufmt-flight_recorder.bench", ec);
+
+        ufmt::text line;
+        line.format("line ", 127562u, ", value ", -127562.127562, '\n');
+        auto const copied = recorder_ns_per_record(records, [&](unsigned) {
+            recorder->write(line.view(), ec);
+        });
+        auto const recorded = recorder_ns_per_record(records, [&](unsigned i) {
+            recorder->print("line ", i, ", value ", -127562.127562);
+        });
+        recorder->close();
+        ufmt::flight_recorder::remove("ufmt-flight_recorder.bench", ec);
+
+        auto file = ufmt::buffered_file<>::create_always("/dev/null", ec);
+        auto const buffered = recorder_ns_per_record(records, [&](unsigned i) {
+            file->print("line ", i, ", value ", -127562.127562);
+        });
+
+        char text[128];
+        std::cout << "flight recorder                    ns/record\n";
+        std::snprintf(text, sizeof(text), "write finished text                %.1f\n", copied);
+        std::cout << text;
+        std::snprintf(text, sizeof(text), "print                              %.1f\n", recorded);
+        std::cout << text;
+        std::snprintf(text, sizeof(text), "buffered_file print (/dev/null)    %.1f\n", buffered);
+        std::cout << text << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,32 @@
+#pragma once
+
+
+#include <iostream>
+
+#include <ufmt/log.hpp>
+
+#include "ubench.hpp"
+
+
+namespace bench {
+
+
+    inline void disabled_log() {
+        auto const saved = ufmt::get_level();
+        ufmt::set_level(ufmt::level::warn);
+        auto value = 0;
+
+        auto const function = ubench::run([&] {
+            ufmt::debug("value: ", ++value, ", ", -127562.127562);
+        });
+        auto const macro = ubench::run([&] {
+            UFMT_DEBUG("value: ", ++value, ", ", -127562.127562);
+        });
+        ufmt::set_level(saved);
+
+        std::cout << "disabled ufmt::debug(...)    - " << function << '\n';
+        std::cout << "disabled UFMT_DEBUG(...)     - " << macro << '\n';
+        std::cout << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,52 @@
+#pragma once
+
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include <ufmt/mapped_text_file.hpp>
+#include <ufmt/text_file.hpp>
+
+#include "buffered_file.bench.hpp"
+
+
+namespace bench {
+
+
+    inline void mapped_file_lines(std::string const& directory) {
+        constexpr auto lines = 4000000u;
+        auto const path = directory + "/ufmt-mapped_text_file.bench.log";
+        std::error_code ec;
+
+        double direct, mapped;
+        {
+            auto file = ufmt::text_file<>::create_always(path, ec);
+            direct = file_lines_per_second(lines / 10, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        {
+            auto file = ufmt::mapped_text_file::create_always(path, ec);
+            mapped = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        std::remove(path.data());
+
+        char line[128];
+        std::cout << "file output to " << directory << "    lines/s\n";
+        std::snprintf(line, sizeof(line), "text_file                        %.0f\n", direct);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "mapped_text_file                 %.0f\n", mapped);
+        std::cout << line << std::endl;
+    }
+
+
+    inline void mapped_file_lines() {
+        mapped_file_lines(".");
+        mapped_file_lines("/dev/shm");
+    }
+
+} // namespace bench
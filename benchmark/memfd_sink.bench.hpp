@@ -0,0 +1,77 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ufmt/memfd_sink.hpp>
+#include <ufmt/sink.hpp>
+
+
+namespace bench {
+
+
+    // A large report handed to another process: streamed over a socket
+    // or formatted into a memfd whose descriptor is passed instead
+    inline void memfd_report() {
+        constexpr auto rows = 1000000u;
+        using namespace std::chrono;
+        std::error_code ec;
+        std::size_t bytes = 0;
+
+        int pair[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+        auto started = steady_clock::now();
+        std::thread reader{[&] {
+            std::string received;
+            char chunk[65536];
+            for(auto n = ::read(pair[1], chunk, sizeof(chunk)); n > 0;
+                n = ::read(pair[1], chunk, sizeof(chunk)))
+                received.append(chunk, std::size_t(n));
+            bytes = received.size();
+        }};
+        {
+            ufmt::text report;
+            for(auto i = 0u; i != rows; ++i)
+                report.format("row ", i, ", value ", -127562.127562, '\n');
+            ufmt::socket_sink socket{pair[0]};
+            socket.write(report.view(), ec);
+        }
+        reader.join();
+        auto const streamed = duration<double, std::milli>(steady_clock::now() - started).count();
+        ::close(pair[1]);
+
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+        started = steady_clock::now();
+        std::thread receiver{[&] {
+            auto view = ufmt::memfd_view::receive(pair[1], ec);
+            bytes = view ? view->view().size() : 0;
+        }};
+        {
+            auto report = ufmt::memfd_sink::create("ufmt-report", ec);
+            for(auto i = 0u; i != rows; ++i)
+                report->print("row ", i, ", value ", -127562.127562);
+            report->send(pair[0], ec);
+        }
+        receiver.join();
+        auto const passed = duration<double, std::milli>(steady_clock::now() - started).count();
+        ::close(pair[0]);
+        ::close(pair[1]);
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "report of %zu MiB to another process    ms\n", bytes >> 20);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "text streamed over unix socket         %.1f\n", streamed);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "memfd_sink, descriptor passed          %.1f\n", passed);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
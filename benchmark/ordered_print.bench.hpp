@@ -0,0 +1,60 @@
+#pragma once
+
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+#include <ufmt/ordered_print.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    // CPU time of the calling thread, not affected by time slicing
+    inline std::uint64_t thread_time_ns() noexcept {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return std::uint64_t(ts.tv_sec) * 1000000000u + std::uint64_t(ts.tv_nsec);
+    }
+
+
+    inline void ordered_print_threads() {
+        constexpr auto lines_per_thread = 100000u;
+
+        std::cout << "threads    ordered_printer (ns/line on producer)    dropped\n";
+        for(auto threads = 1u; threads <= 8u; threads *= 2) {
+            std::atomic<std::uint64_t> total_ns{0};
+            std::uint64_t dropped;
+            {
+                silenced_stdout silenced;
+                ufmt::ordered_printer printer{{.capacity = 65536}};
+                std::vector<std::thread> producers;
+                for(auto t = 0u; t != threads; ++t)
+                    producers.emplace_back([&, t] {
+                        auto const started = thread_time_ns();
+                        for(auto i = 0u; i != lines_per_thread; ++i)
+                            printer.print("thread ", t, ", line ", i, ", value ", -127562.127562);
+                        total_ns.fetch_add(thread_time_ns() - started);
+                    });
+                for(auto& producer: producers)
+                    producer.join();
+                printer.flush();
+                dropped = printer.dropped();
+            }
+            char line[128];
+            std::snprintf(line, sizeof(line), "%7u    %37.1f    %7llu\n", threads,
+                          double(total_ns.load()) / (double(threads) * lines_per_thread),
+                          (unsigned long long)dropped);
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+
+} // namespace bench
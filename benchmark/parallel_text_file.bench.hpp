@@ -0,0 +1,52 @@
+#pragma once
+
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <ufmt/parallel_text_file.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    inline void parallel_file_threads() {
+        constexpr auto lines = 400000u;
+        auto const path = std::string{"ufmt-parallel_text_file.bench.log"};
+        std::error_code ec;
+
+        std::cout << "threads    O_APPEND write (lines/s)    parallel_text_file (lines/s)\n";
+        for(auto threads = 1u; threads <= 8u; threads *= 2) {
+            auto const fd = ::open(path.data(), O_CREAT | O_TRUNC | O_WRONLY | O_APPEND, 0644);
+            auto const appended = lines_per_second(threads, lines / threads, [fd](unsigned t, unsigned n) {
+                ufmt::text line;
+                for(auto i = 0u; i != n; ++i) {
+                    line.clear();
+                    line.format("thread ", t, ", line ", i, ", value ", -127562.127562, '\n');
+                    ::write(fd, line.data(), line.size());
+                }
+            });
+            ::close(fd);
+
+            auto file = ufmt::parallel_text_file::create_always(path, ec);
+            auto const positioned = lines_per_second(threads, lines / threads, [&](unsigned t, unsigned n) {
+                for(auto i = 0u; i != n; ++i)
+                    file->print("thread ", t, ", line ", i, ", value ", -127562.127562);
+            });
+
+            char row[128];
+            std::snprintf(row, sizeof(row), "%-10u %-27.0f %.0f\n", threads, appended, positioned);
+            std::cout << row;
+        }
+        std::cout << std::endl;
+        std::remove(path.data());
+    }
+
+} // namespace bench
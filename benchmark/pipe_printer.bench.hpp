@@ -0,0 +1,56 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <ufmt/pipe_printer.hpp>
+
+
+namespace bench {
+
+
+    // Lines per second into a pipe drained by a local reader thread
+    inline double pipe_lines_per_second(unsigned lines, bool splice) {
+        using namespace std::chrono;
+        int fds[2];
+        if(::pipe(fds) == -1)
+            return 0;
+        std::thread reader{[&] {
+            static char chunk[65536];
+            while(::read(fds[0], chunk, sizeof(chunk)) > 0)
+                ;
+        }};
+        auto const started = steady_clock::now();
+        {
+            ufmt::pipe_printer printer{{.fd = fds[1], .splice = splice}};
+            for(auto i = 0u; i != lines; ++i)
+                printer.print("line ", i, ", value ", -127562.127562);
+        }
+        ::close(fds[1]);
+        reader.join();
+        auto const elapsed = duration<double>(steady_clock::now() - started).count();
+        ::close(fds[0]);
+        return lines / elapsed;
+    }
+
+
+    inline void pipe_printer_lines() {
+        constexpr auto lines = 4000000u;
+        auto const copied = pipe_lines_per_second(lines, false);
+        auto const spliced = pipe_lines_per_second(lines, true);
+
+        char line[128];
+        std::cout << "pipe to local reader               lines/s\n";
+        std::snprintf(line, sizeof(line), "pipe_printer write(2)              %.0f\n", copied);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "pipe_printer vmsplice              %.0f\n", spliced);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
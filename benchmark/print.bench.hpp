@@ -0,0 +1,95 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <ufmt/print.hpp>
+
+
+namespace bench {
+
+
+    // Redirects stdout to /dev/null while alive
+    class silenced_stdout {
+        int saved_;
+
+    public:
+
+        silenced_stdout() noexcept: saved_{::dup(1)} {
+            auto const null = ::open("/dev/null", O_WRONLY);
+            ::dup2(null, 1);
+            ::close(null);
+            ufmt::output_redirected();
+        }
+
+        ~silenced_stdout() {
+            ::dup2(saved_, 1);
+            ::close(saved_);
+            ufmt::output_redirected();
+        }
+
+        silenced_stdout(silenced_stdout const&) = delete;
+        silenced_stdout& operator = (silenced_stdout const&) = delete;
+    }; // silenced_stdout
+
+
+    // Runs f(thread_index, lines_per_thread) on n threads, returns lines per second
+    template<typename F>
+    double lines_per_second(unsigned threads, unsigned lines_per_thread, F&& f) {
+        using namespace std::chrono;
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        auto const started = steady_clock::now();
+        for(auto t = 0u; t != threads; ++t)
+            workers.emplace_back([&f, t, lines_per_thread] { f(t, lines_per_thread); });
+        for(auto& worker: workers)
+            worker.join();
+        auto const elapsed = duration<double>(steady_clock::now() - started).count();
+        return double(threads) * lines_per_thread / elapsed;
+    }
+
+
+    inline void print_threads() {
+        constexpr auto lines_per_thread = 100000u;
+
+        std::mutex global_sync;
+        ufmt::text global_buffer;
+
+        auto const locked_print = [&](unsigned t, unsigned n) {
+            for(auto i = 0u; i != n; ++i) {
+                std::unique_lock g {global_sync};
+                global_buffer.clear();
+                global_buffer.format("thread ", t, ", line ", i, ", value ", -127562.127562, '\n');
+                ::write(1, global_buffer.data(), global_buffer.size());
+            }
+        };
+
+        auto const thread_local_print = [](unsigned t, unsigned n) {
+            for(auto i = 0u; i != n; ++i)
+                ufmt::print("thread ", t, ", line ", i, ", value ", -127562.127562);
+        };
+
+        std::cout << "threads    locked print (lines/s)    ufmt::print (lines/s)\n";
+        for(auto threads = 1u; threads <= 32u; threads *= 2) {
+            double locked, parallel;
+            {
+                silenced_stdout silenced;
+                locked = lines_per_second(threads, lines_per_thread, locked_print);
+                parallel = lines_per_second(threads, lines_per_thread, thread_local_print);
+            }
+            char line[128];
+            std::snprintf(line, sizeof(line), "%7u    %22.0f    %21.0f\n", threads, locked, parallel);
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include <ufmt/print.hpp>
+#include <ufmt/printer.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    // Prints bursts of lines separated by idle pauses, returns lines per second of busy time
+    template<typename F>
+    double bursty_lines_per_second(unsigned bursts, unsigned lines_per_burst, F&& f) {
+        using namespace std::chrono;
+        auto busy = steady_clock::duration{};
+        for(auto b = 0u; b != bursts; ++b) {
+            auto const started = steady_clock::now();
+            for(auto i = 0u; i != lines_per_burst; ++i)
+                f(i);
+            busy += steady_clock::now() - started;
+            std::this_thread::sleep_for(milliseconds{2});
+        }
+        return double(bursts) * lines_per_burst / duration<double>(busy).count();
+    }
+
+
+    inline void printer_bursts() {
+        constexpr auto bursts = 100u;
+        constexpr auto lines_per_burst = 1000u;
+
+        // flushes without background_flush happen on this thread, so its
+        // count of write calls covers all of them
+        auto& calls = ufmt::detail::io::system_calls;
+        double direct, coalesced, direct_calls, coalesced_calls;
+        {
+            silenced_stdout silenced;
+            auto calls_before = calls;
+            direct = bursty_lines_per_second(bursts, lines_per_burst, [](unsigned i) {
+                ufmt::print("line ", i, ", value ", -127562.127562);
+            });
+            direct_calls = double(calls - calls_before) / (bursts * lines_per_burst);
+
+            calls_before = calls;
+            ufmt::printer printer{{.max_delay = std::chrono::milliseconds{1}}};
+            coalesced = bursty_lines_per_second(bursts, lines_per_burst, [&](unsigned i) {
+                printer.print("line ", i, ", value ", -127562.127562);
+            });
+            printer.flush();
+            coalesced_calls = double(calls - calls_before) / double(printer.lines());
+        }
+
+        char line[128];
+        std::cout << "bursts of 1000 lines    lines/s        syscalls/line\n";
+        std::snprintf(line, sizeof(line), "ufmt::print             %-13.0f  %.4f\n", direct, direct_calls);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "ufmt::printer           %-13.0f  %.4f\n", coalesced, coalesced_calls);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
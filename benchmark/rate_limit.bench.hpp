@@ -0,0 +1,45 @@
+#pragma once
+
+
+#include <chrono>
+#include <iostream>
+
+#include <ufmt/rate_limit.hpp>
+
+#include "print.bench.hpp"
+#include "ubench.hpp"
+
+
+namespace bench {
+
+
+    inline void suppressed_print() {
+        ufmt::fixed_text text;
+        auto value = 0;
+
+        ubench::result formatted, every_n, at_most_per, sampled;
+        {
+            silenced_stdout silenced;
+            formatted = ubench::run([&] {
+                text.clear();
+                text.format("error: ", ++value, ", ", -127562.127562);
+            });
+            every_n = ubench::run([&] {
+                UFMT_PRINT_EVERY_N(1000000000, "error: ", ++value, ", ", -127562.127562);
+            });
+            at_most_per = ubench::run([&] {
+                UFMT_PRINT_AT_MOST_PER(std::chrono::hours{1}, "error: ", ++value, ", ", -127562.127562);
+            });
+            sampled = ubench::run([&] {
+                UFMT_PRINT_SAMPLED(0., "error: ", ++value, ", ", -127562.127562);
+            });
+        }
+
+        std::cout << "text.format(error)                 - " << formatted << '\n';
+        std::cout << "dropped UFMT_PRINT_EVERY_N         - " << every_n << '\n';
+        std::cout << "dropped UFMT_PRINT_AT_MOST_PER     - " << at_most_per << '\n';
+        std::cout << "dropped UFMT_PRINT_SAMPLED         - " << sampled << '\n';
+        std::cout << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,72 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ufmt/shared_text.hpp>
+
+
+namespace bench {
+
+
+    template<typename F>
+    double batch_ms(F&& f) {
+        using namespace std::chrono;
+        auto const started = steady_clock::now();
+        f();
+        return duration<double, std::milli>(steady_clock::now() - started).count();
+    }
+
+
+    // A batch export formatted by several threads into one output buffer
+    inline void shared_text_batch() {
+        constexpr auto threads = 4u;
+        constexpr auto lines = 500000u;
+
+        std::string joined;
+        auto const concatenated = batch_ms([&] {
+            std::vector<ufmt::text> parts(threads);
+            std::vector<std::thread> workers;
+            for(auto t = 0u; t != threads; ++t)
+                workers.emplace_back([&, t] {
+                    for(auto i = 0u; i != lines; ++i)
+                        parts[t].format("row ", t, ':', i, ", value ", -127562.127562, '\n');
+                });
+            for(auto& w: workers)
+                w.join();
+            std::size_t size = 0;
+            for(auto const& p: parts)
+                size += p.size();
+            joined.reserve(size);
+            for(auto const& p: parts)
+                joined.append(p.data(), p.size());
+        });
+
+        ufmt::shared_text shared{joined.size() + 4096};
+        auto const reserved = batch_ms([&] {
+            std::vector<std::thread> workers;
+            for(auto t = 0u; t != threads; ++t)
+                workers.emplace_back([&, t] {
+                    for(auto i = 0u; i != lines; ++i)
+                        shared.print("row ", t, ':', i, ", value ", -127562.127562);
+                });
+            for(auto& w: workers)
+                w.join();
+        });
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "batch of %u x %u lines            ms\n", threads, lines);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "per-thread text + concatenation      %.1f\n", concatenated);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "shared_text, scratch + copy (%zu MiB) %.1f\n",
+                      shared.view().size() >> 20, reserved);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
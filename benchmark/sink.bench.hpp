@@ -0,0 +1,73 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <ufmt/buffered_file.hpp>
+#include <ufmt/print.hpp>
+#include <ufmt/sink.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    template<typename F>
+    double sink_ns_per_line(unsigned lines, F&& f) {
+        using namespace std::chrono;
+        auto const started = steady_clock::now();
+        for(auto i = 0u; i != lines; ++i)
+            f(i);
+        return duration<double, std::nano>(steady_clock::now() - started).count() / lines;
+    }
+
+
+    // The same line to two destinations: formatted twice or once by logger
+    inline void sink_fan_out() {
+        constexpr auto lines = 1000000u;
+        std::error_code ec;
+
+        auto first = ufmt::buffered_file<>::create_always("/dev/null", ec);
+        auto second = ufmt::buffered_file<>::create_always("/dev/null", ec);
+        auto const buffered_twice = sink_ns_per_line(lines, [&](unsigned i) {
+            first->print("line ", i, ", value ", -127562.127562);
+            second->print("line ", i, ", value ", -127562.127562);
+        });
+        ufmt::logger<ufmt::buffered_file<>&, ufmt::buffered_file<>&> buffered{*first, *second};
+        auto const buffered_once = sink_ns_per_line(lines, [&](unsigned i) {
+            buffered.print("line ", i, ", value ", -127562.127562);
+        });
+
+        double print_twice, fd_once;
+        {
+            silenced_stdout silenced;
+            print_twice = sink_ns_per_line(lines, [](unsigned i) {
+                ufmt::print("line ", i, ", value ", -127562.127562);
+                ufmt::print("line ", i, ", value ", -127562.127562);
+            });
+            ufmt::logger fds{ufmt::fd_sink{1}, ufmt::fd_sink{1}};
+            fd_once = sink_ns_per_line(lines, [&](unsigned i) {
+                fds.print("line ", i, ", value ", -127562.127562);
+            });
+        }
+
+        char line[128];
+        std::cout << "line to two sinks                  ns/line\n";
+        std::snprintf(line, sizeof(line), "buffered_file print x2             %.1f\n", buffered_twice);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "logger<buffered_file&, ...>        %.1f\n", buffered_once);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "ufmt::print x2                     %.1f\n", print_twice);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "logger<fd_sink, fd_sink>           %.1f\n", fd_once);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
@@ -0,0 +1,61 @@
+#pragma once
+
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <ufmt/print.hpp>
+
+#include "print.bench.hpp"
+
+
+namespace bench {
+
+
+    // Previous print lock: yields after every failed attempt
+    class yielding_lock {
+        std::atomic_bool flag_{false};
+
+    public:
+
+        void lock() noexcept {
+            while(flag_.load(std::memory_order_relaxed)
+                  || flag_.exchange(true, std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        void unlock() noexcept { flag_.store(false, std::memory_order_release); }
+    }; // yielding_lock
+
+
+    template<class Lock>
+    double locks_per_second(unsigned threads, Lock& lock) {
+        constexpr auto locks_per_thread = 200000u;
+        std::uint64_t counter = 0;
+        return lines_per_second(threads, locks_per_thread, [&](unsigned, unsigned n) {
+            for(auto i = 0u; i != n; ++i) {
+                std::unique_lock g{lock};
+                ++counter;
+            }
+        });
+    }
+
+
+    inline void spinlock_threads() {
+        std::cout << "threads    yielding lock (locks/s)    adaptive spinlock (locks/s)\n";
+        for(auto threads = 1u; threads <= 8u; threads *= 2) {
+            yielding_lock yielding;
+            ufmt::detail::printer::spinlock adaptive;
+            auto const old_rate = locks_per_second(threads, yielding);
+            auto const new_rate = locks_per_second(threads, adaptive);
+            char line[128];
+            std::snprintf(line, sizeof(line), "%7u    %23.0f    %27.0f\n", threads, old_rate, new_rate);
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+
+} // namespace bench
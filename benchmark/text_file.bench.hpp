@@ -0,0 +1,58 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <ufmt/text_file.hpp>
+
+
+namespace bench {
+
+
+    // Batches of finished texts written one by one and gathered into writev
+    inline void text_file_batches() {
+        constexpr auto batches = 20000u;
+        constexpr auto batch_size = 16u;
+        auto const path = std::string{"/dev/null"};
+
+        std::vector<ufmt::text> records(batch_size);
+        std::vector<ufmt::text const*> batch;
+        for(auto i = 0u; i != batch_size; ++i) {
+            records[i].format("record ", i, ", value ", -127562.127562, '\n');
+            batch.push_back(&records[i]);
+        }
+
+        using namespace std::chrono;
+        std::error_code ec;
+        auto file = ufmt::text_file<>::create_always(path, ec);
+
+        auto& calls = ufmt::detail::io::system_calls;
+        auto calls_before = calls;
+        auto started = steady_clock::now();
+        for(auto b = 0u; b != batches; ++b)
+            for(auto const* record: batch)
+                file->write(record->view(), ec);
+        auto const separate = duration<double, std::nano>(steady_clock::now() - started).count() / batches;
+        auto const separate_calls = double(calls - calls_before) / batches;
+
+        calls_before = calls;
+        started = steady_clock::now();
+        for(auto b = 0u; b != batches; ++b)
+            file->write_all(batch, ec);
+        auto const gathered = duration<double, std::nano>(steady_clock::now() - started).count() / batches;
+        auto const gathered_calls = double(calls - calls_before) / batches;
+
+        char line[128];
+        std::cout << "batch of 16 texts    ns/batch    syscalls/batch\n";
+        std::snprintf(line, sizeof(line), "write per text       %-10.0f  %.2f\n", separate, separate_calls);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "write_all (writev)   %-10.0f  %.2f\n", gathered, gathered_calls);
+        std::cout << line << std::endl;
+    }
+
+} // namespace bench
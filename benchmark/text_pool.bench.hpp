@@ -0,0 +1,96 @@
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ufmt/text_pool.hpp>
+
+
+namespace bench {
+
+
+    // Single producer, single consumer ring of moved values
+    template<class T> class handoff {
+        std::vector<T> slots_;
+        alignas(64) std::atomic<std::size_t> tail_{0};
+        alignas(64) std::atomic<std::size_t> head_{0};
+
+    public:
+
+        explicit handoff(std::size_t capacity): slots_(capacity) { }
+
+        void push(T&& value) {
+            auto const t = tail_.load(std::memory_order_relaxed);
+            while(t - head_.load(std::memory_order_acquire) == slots_.size())
+                std::this_thread::yield();
+            slots_[t % slots_.size()] = std::move(value);
+            tail_.store(t + 1, std::memory_order_release);
+        }
+
+        T pop() {
+            auto const h = head_.load(std::memory_order_relaxed);
+            while(tail_.load(std::memory_order_acquire) == h)
+                std::this_thread::yield();
+            auto value = std::move(slots_[h % slots_.size()]);
+            head_.store(h + 1, std::memory_order_release);
+            return value;
+        }
+    }; // handoff
+
+
+    template<class T, typename Produce, typename Consume>
+    double handoff_ns_per_message(unsigned messages, Produce&& produce, Consume&& consume) {
+        using namespace std::chrono;
+        handoff<T> ring{64};
+        auto const started = steady_clock::now();
+        std::thread consumer{[&] {
+            for(auto i = 0u; i != messages; ++i)
+                consume(ring.pop());
+        }};
+        for(auto i = 0u; i != messages; ++i)
+            ring.push(produce(i));
+        consumer.join();
+        return duration<double, std::nano>(steady_clock::now() - started).count() / messages;
+    }
+
+
+    // Passing formatted lines to a consumer thread
+    inline void text_pool_handoff() {
+        constexpr auto messages = 1000000u;
+        std::size_t consumed = 0;
+
+        auto const moved = handoff_ns_per_message<ufmt::text>(messages,
+            [](unsigned i) {
+                ufmt::text t;
+                t.format("message ", i, ", value ", -127562.127562, ", state ", ufmt::quoted("running"));
+                return t;
+            },
+            [&](ufmt::text t) { consumed += t.size(); });
+
+        ufmt::text_pool<> pool{64, 128};
+        auto const pooled = handoff_ns_per_message<ufmt::text_handle<>>(messages,
+            [&](unsigned i) {
+                auto h = pool.acquire();
+                h->format("message ", i, ", value ", -127562.127562, ", state ", ufmt::quoted("running"));
+                return h;
+            },
+            [&](ufmt::text_handle<> h) { consumed += h->size(); });
+
+        char line[128];
+        std::cout << "text to consumer thread            ns/message\n";
+        std::snprintf(line, sizeof(line), "moved text (allocated each time)   %.1f\n", moved);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "text_handle from text_pool         %.1f (%zu texts)\n",
+                      pooled, pool.allocated());
+        std::cout << line << std::endl;
+        if(consumed == 0)
+            std::cout << '\n';
+    }
+
+} // namespace bench
@@ -0,0 +1,72 @@
+#pragma once
+
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include <ufmt/buffered_file.hpp>
+#include <ufmt/text_file.hpp>
+#include <ufmt/uring_text_file.hpp>
+
+#include "buffered_file.bench.hpp"
+
+
+namespace bench {
+
+
+    // Sustained file output, same line as buffered_file_lines()
+    inline void uring_file_lines(std::string const& directory) {
+        constexpr auto lines = 4000000u;
+        auto const path = directory + "/ufmt-uring_text_file.bench.log";
+        std::error_code ec;
+
+        double direct, buffered, uring, fallback;
+        {
+            auto file = ufmt::text_file<>::create_always(path, ec);
+            direct = file_lines_per_second(lines / 10, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        {
+            auto file = ufmt::buffered_file<>::create_always(path, ec);
+            buffered = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+        }
+        {
+            auto file = ufmt::uring_text_file<>::create_always(path, ec);
+            uring = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+            file->flush();
+        }
+        {
+            auto file = ufmt::uring_text_file<>::create_always(path, ec, {.fallback = true});
+            fallback = file_lines_per_second(lines, [&](unsigned i) {
+                file->print("line ", i, ", value ", -127562.127562);
+            });
+            file->flush();
+        }
+        std::remove(path.data());
+
+        char line[128];
+        std::cout << "file output to " << directory << "    lines/s\n";
+        std::snprintf(line, sizeof(line), "text_file                        %.0f\n", direct);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "buffered_file                    %.0f\n", buffered);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "uring_text_file                  %.0f\n", uring);
+        std::cout << line;
+        std::snprintf(line, sizeof(line), "uring_text_file (fallback)       %.0f\n", fallback);
+        std::cout << line << std::endl;
+    }
+
+
+    inline void uring_file_lines() {
+        uring_file_lines(".");
+        uring_file_lines("/dev/shm");
+    }
+
+} // namespace bench
@@ -0,0 +1,124 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    // Growable character storage aligned to the page (or any other) boundary,
+    // resize() leaves new characters uninitialized
+    template<std::size_t Alignment = 4096>
+    class aligned_string {
+        char* data_{nullptr};
+        std::size_t size_{0};
+        std::size_t capacity_{0};
+
+    public:
+
+        using value_type = char;
+        using size_type = std::size_t;
+
+        static constexpr size_type alignment = Alignment;
+
+
+        aligned_string() noexcept = default;
+
+        explicit aligned_string(std::string_view sv) {
+            reserve(sv.size());
+            std::memcpy(data_, sv.data(), sv.size());
+            size_ = sv.size();
+        }
+
+        ~aligned_string() { release(); }
+
+        aligned_string(aligned_string const& other): aligned_string{other.view()} { }
+
+        aligned_string& operator = (aligned_string const& other) {
+            if(this == &other)
+                return *this;
+            clear();
+            reserve(other.size_);
+            std::memcpy(data_, other.data_, other.size_);
+            size_ = other.size_;
+            return *this;
+        }
+
+        aligned_string(aligned_string&& other) noexcept
+            : data_{std::exchange(other.data_, nullptr)},
+              size_{std::exchange(other.size_, 0)},
+              capacity_{std::exchange(other.capacity_, 0)} { }
+
+        aligned_string& operator = (aligned_string&& other) noexcept {
+            if(this == &other)
+                return *this;
+            release();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+            return *this;
+        }
+
+
+        char* data() noexcept { return data_; }
+        char const* data() const noexcept { return data_; }
+        size_type size() const noexcept { return size_; }
+        size_type capacity() const noexcept { return capacity_; }
+        bool empty() const noexcept { return size_ == 0; }
+        void clear() noexcept { size_ = 0; }
+        char& operator[](size_type i) noexcept { return data_[i]; }
+        char operator[](size_type i) const noexcept { return data_[i]; }
+        std::string_view view() const noexcept { return {data_, size_}; }
+
+
+        void reserve(size_type n) {
+            if(n <= capacity_)
+                return;
+            n = (n + Alignment - 1) / Alignment * Alignment;
+            auto* reserved = static_cast<char*>(::operator new(n, std::align_val_t{Alignment}));
+            if(size_ != 0)
+                std::memcpy(reserved, data_, size_);
+            release();
+            data_ = reserved;
+            capacity_ = n;
+        }
+
+
+        void resize(size_type n) {
+            reserve(n);
+            size_ = n;
+        }
+
+
+    private:
+
+        void release() noexcept {
+            if(data_ == nullptr)
+                return;
+            ::operator delete(data_, std::align_val_t{Alignment});
+            data_ = nullptr;
+            capacity_ = 0;
+        }
+    }; // aligned_string
+
+
+    template<typename OS, std::size_t A>
+    OS& operator << (OS& stream, aligned_string<A> const& s) {
+        return stream << s.view();
+    }
+
+
+    using aligned_text = basic_text<aligned_string<>>;
+
+} // namespace ufmt
@@ -0,0 +1,270 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "io.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    enum class backpressure {
+        block,          // wait for the free slot
+        drop_newest,    // discard the line
+        drop_counted    // discard the line and report the number of dropped ones
+    };
+
+
+    struct async_options {
+        std::size_t capacity{4096};
+        backpressure overflow{backpressure::block};
+        int fd{1};
+    }; // async_options
+
+
+    namespace detail::async {
+
+        inline thread_local text buffer;
+
+
+        inline std::size_t ceil_power_of_2(std::size_t n) noexcept {
+            std::size_t p = 2;
+            while(p < n)
+                p <<= 1;
+            return p;
+        }
+
+
+        // "ufmt: N lines dropped\n" written without allocation
+        inline std::size_t format_dropped(char (&out)[64], std::uint64_t n) noexcept {
+            constexpr char prefix[] = "ufmt: ";
+            constexpr char suffix[] = " lines dropped\n";
+            std::memcpy(out, prefix, sizeof(prefix) - 1);
+            auto const digits = std::to_chars(out + sizeof(prefix) - 1, out + sizeof(out), n).ptr;
+            std::memcpy(digits, suffix, sizeof(suffix) - 1);
+            return std::size_t(digits - out) + sizeof(suffix) - 1;
+        }
+
+    } // namespace detail::async
+
+
+    // Lines are formatted on the calling thread and queued into a bounded
+    // multi-producer ring, the background thread writes them in batches
+    class async_printer {
+
+        struct alignas(64) slot {
+            std::atomic<std::size_t> sequence;
+            text line;
+        }; // slot
+
+        std::size_t mask_;
+        std::unique_ptr<slot[]> slots_;
+        backpressure overflow_;
+        int fd_;
+
+        alignas(64) std::atomic<std::size_t> tail_{0};
+        alignas(64) std::atomic<std::size_t> head_{0};
+        alignas(64) std::atomic<std::uint32_t> signal_{0};
+        std::atomic<bool> sleeping_{false};
+        std::atomic<bool> stopping_{false};
+        std::atomic<bool> stopped_{false};
+        std::atomic<std::uint64_t> dropped_{0};
+        std::error_code error_;
+        std::vector<::iovec> batch_;
+        std::thread thread_;
+
+    public:
+
+        explicit async_printer(async_options const& options = async_options{})
+            : mask_{detail::async::ceil_power_of_2(options.capacity) - 1},
+              slots_{new slot[mask_ + 1]},
+              overflow_{options.overflow},
+              fd_{options.fd} {
+            for(std::size_t i = 0; i != mask_ + 1; ++i)
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            batch_.reserve(detail::io::max_buffers + 1);   // queued lines and the drop report
+            thread_ = std::thread{[this] { drain(); }};
+        }
+
+        async_printer(async_printer const&) = delete;
+        async_printer& operator = (async_printer const&) = delete;
+
+        ~async_printer() { stop(); }
+
+
+        std::size_t capacity() const noexcept { return mask_ + 1; }
+
+
+        std::uint64_t dropped() const noexcept {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+
+        // Last write error of the background thread, valid after stop()
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto& buffer = detail::async::buffer;
+            buffer.clear();
+            buffer.format(std::forward<Args>(args)..., '\n');
+            if(stopped_.load(std::memory_order_relaxed)) {
+                std::error_code ec;
+                return detail::io::write_all(fd_, buffer.data(), buffer.size(), ec);
+            }
+            return push(buffer);
+        }
+
+
+        // Waits until every line queued before the call is written
+        void flush() noexcept {
+            auto const target = tail_.load(std::memory_order_seq_cst);
+            wake();
+            for(auto h = head_.load(std::memory_order_acquire); h < target;
+                h = head_.load(std::memory_order_acquire)) {
+                head_.wait(h, std::memory_order_acquire);
+            }
+        }
+
+
+        // Writes all queued lines and joins the background thread,
+        // should not race with print()
+        void stop() noexcept {
+            if(stopping_.exchange(true))
+                return;
+            wake();
+            thread_.join();
+            stopped_.store(true, std::memory_order_relaxed);
+        }
+
+
+    private:
+
+        bool push(text& line) {
+            auto pos = tail_.load(std::memory_order_relaxed);
+            slot* s;
+            for(;;) {
+                s = &slots_[pos & mask_];
+                auto const sequence = s->sequence.load(std::memory_order_acquire);
+                auto const diff = std::intptr_t(sequence) - std::intptr_t(pos);
+                if(diff == 0) {
+                    if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed))
+                        break;
+                } else if(diff < 0) {
+                    if(overflow_ != backpressure::block) {
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    wait_for_room(pos);
+                    pos = tail_.load(std::memory_order_relaxed);
+                } else {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+            std::swap(s->line, line);
+            s->sequence.store(pos + 1, std::memory_order_release);
+            if(sleeping_.load(std::memory_order_seq_cst))
+                wake();
+            return true;
+        }
+
+
+        void wait_for_room(std::size_t pos) noexcept {
+            wake();
+            auto h = head_.load(std::memory_order_acquire);
+            if(pos - h > mask_)
+                head_.wait(h, std::memory_order_acquire);
+        }
+
+
+        void wake() noexcept {
+            signal_.fetch_add(1, std::memory_order_seq_cst);
+            signal_.notify_one();
+        }
+
+
+        // Never allocates, the batch is reserved up front and the report
+        // of dropped lines is formatted on the stack
+        void drain() noexcept {
+            auto& batch = batch_;
+            auto pos = head_.load(std::memory_order_relaxed);
+            std::uint64_t reported = 0;
+            char report[64];
+
+            for(;;) {
+                batch.clear();
+                auto end = pos;
+                while(batch.size() != detail::io::max_buffers) {
+                    auto& s = slots_[end & mask_];
+                    if(s.sequence.load(std::memory_order_acquire) != end + 1)
+                        break;
+                    batch.push_back(::iovec{const_cast<char*>(s.line.data()), s.line.size()});
+                    ++end;
+                }
+
+                if(overflow_ == backpressure::drop_counted) {
+                    auto const dropped = dropped_.load(std::memory_order_relaxed);
+                    if(dropped != reported) {
+                        batch.push_back(::iovec{report, detail::async::format_dropped(
+                                                            report, dropped - reported)});
+                        reported = dropped;
+                    }
+                }
+
+                if(!batch.empty()) {
+                    std::error_code ec;
+                    if(!detail::io::write_all(fd_, batch.data(), batch.size(), ec))
+                        error_ = ec;
+                    for(; pos != end; ++pos) {
+                        auto& s = slots_[pos & mask_];
+                        s.line.clear();
+                        s.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    }
+                    head_.store(pos, std::memory_order_release);
+                    head_.notify_all();
+                    continue;
+                }
+
+                auto const signal = signal_.load(std::memory_order_seq_cst);
+                auto const tail = tail_.load(std::memory_order_seq_cst);
+                if(tail != pos) {
+                    // claimed slot is being filled right now
+                    std::this_thread::yield();
+                    continue;
+                }
+                if(stopping_.load(std::memory_order_seq_cst)) {
+                    // lines dropped just before stop() are reported too
+                    if(overflow_ != backpressure::drop_counted
+                       || dropped_.load(std::memory_order_relaxed) == reported)
+                        return;
+                    continue;
+                }
+                sleeping_.store(true, std::memory_order_seq_cst);
+                if(tail_.load(std::memory_order_seq_cst) == pos
+                   && !stopping_.load(std::memory_order_seq_cst))
+                    signal_.wait(signal, std::memory_order_seq_cst);
+                sleeping_.store(false, std::memory_order_relaxed);
+            }
+        }
+    }; // async_printer
+
+} // namespace ufmt
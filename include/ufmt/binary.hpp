@@ -0,0 +1,579 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fixed_string.hpp"
+#include "io.hpp"
+#include "text.hpp"
+
+
+// Logs a line in binary form: UFMT_BINARY_PRINT(writer, "value: ", x);
+// String literals are stored once per call site, other arguments as raw bytes.
+// An argument is a literal when it is spelled as one, so arguments with
+// top level commas (template arguments) have to be parenthesized
+#define UFMT_BINARY_PRINT(writer, ...)                                            \
+    [&](auto&&... ufmt_args) {                                                    \
+        static auto const& ufmt_site = ::ufmt::detail::binary::register_site(    \
+            std::forward<decltype(ufmt_args)>(ufmt_args)...);                     \
+        (writer).write(ufmt_site, std::forward<decltype(ufmt_args)>(ufmt_args)...); \
+    }(UFMT_DETAIL_FOR_EACH(UFMT_DETAIL_BINARY_ARGUMENT, __VA_ARGS__))
+
+#define UFMT_DETAIL_BINARY_ARGUMENT(arg)                                          \
+    ::ufmt::detail::binary::mark<(#arg)[0] == '"'>(arg)
+
+// Applies macro to every argument, up to 256 of them
+#define UFMT_DETAIL_PARENS ()
+#define UFMT_DETAIL_EXPAND(...)  UFMT_DETAIL_EXPAND3(UFMT_DETAIL_EXPAND3(UFMT_DETAIL_EXPAND3(UFMT_DETAIL_EXPAND3(__VA_ARGS__))))
+#define UFMT_DETAIL_EXPAND3(...) UFMT_DETAIL_EXPAND2(UFMT_DETAIL_EXPAND2(UFMT_DETAIL_EXPAND2(UFMT_DETAIL_EXPAND2(__VA_ARGS__))))
+#define UFMT_DETAIL_EXPAND2(...) UFMT_DETAIL_EXPAND1(UFMT_DETAIL_EXPAND1(UFMT_DETAIL_EXPAND1(UFMT_DETAIL_EXPAND1(__VA_ARGS__))))
+#define UFMT_DETAIL_EXPAND1(...) __VA_ARGS__
+#define UFMT_DETAIL_FOR_EACH(macro, ...)                                          \
+    __VA_OPT__(UFMT_DETAIL_EXPAND(UFMT_DETAIL_FOR_EACH_NEXT(macro, __VA_ARGS__)))
+#define UFMT_DETAIL_FOR_EACH_NEXT(macro, first, ...)                              \
+    macro(first) __VA_OPT__(, UFMT_DETAIL_FOR_EACH_AGAIN UFMT_DETAIL_PARENS (macro, __VA_ARGS__))
+#define UFMT_DETAIL_FOR_EACH_AGAIN() UFMT_DETAIL_FOR_EACH_NEXT
+
+
+namespace ufmt {
+
+
+    enum class binary_kind : std::uint8_t {
+        literal,
+        character,
+        i32,
+        u32,
+        i64,
+        u64,
+        f32,
+        f64,
+        string,
+        precised,
+        fixed_i32,
+        fixed_u32,
+        fixed_i64,
+        fixed_u64
+    }; // binary_kind
+
+
+    namespace detail::binary {
+
+        constexpr char magic[8] = {'U', 'F', 'M', 'T', 'B', 'I', 'N', '1'};
+        constexpr char descriptor_tag = 'D';
+        constexpr char records_tag = 'R';
+
+
+        struct site {
+            std::uint32_t id;
+            std::vector<binary_kind> kinds;
+            std::vector<std::string> literals;
+        }; // site
+
+
+        inline std::mutex registry_sync;
+        inline std::vector<std::unique_ptr<site>> registry;
+
+
+        // String literal argument of UFMT_BINARY_PRINT
+        template<std::size_t N>
+        struct literal {
+            char const (&value)[N];
+        }; // literal
+
+
+        template<typename Arg>
+        constexpr bool is_literal_of = false;
+
+        template<std::size_t N>
+        constexpr bool is_literal_of<literal<N>> = true;
+
+        template<typename Arg>
+        constexpr bool is_literal = is_literal_of<std::remove_cvref_t<Arg>>;
+
+
+        // Wraps arguments spelled as string literals, other char arrays
+        // are copied into every record like any string
+        template<bool Spelled, typename Arg>
+        decltype(auto) mark(Arg&& arg) noexcept {
+            using type = std::remove_reference_t<Arg>;
+            if constexpr(Spelled && std::is_array_v<type>
+                         && std::is_same_v<std::remove_extent_t<type>, char const>)
+                return literal<std::extent_v<type>>{arg};
+            else
+                return std::forward<Arg>(arg);
+        }
+
+
+        template<typename T>
+        constexpr binary_kind kind_of() noexcept {
+            using type = std::remove_cvref_t<T>;
+            if constexpr(std::is_same_v<type, char>)
+                return binary_kind::character;
+            else if constexpr(std::is_same_v<type, std::int32_t>)
+                return binary_kind::i32;
+            else if constexpr(std::is_same_v<type, std::uint32_t>)
+                return binary_kind::u32;
+            else if constexpr(std::is_same_v<type, std::int64_t>)
+                return binary_kind::i64;
+            else if constexpr(std::is_same_v<type, std::uint64_t>)
+                return binary_kind::u64;
+            else if constexpr(std::is_same_v<type, float>)
+                return binary_kind::f32;
+            else if constexpr(std::is_same_v<type, double>)
+                return binary_kind::f64;
+            else if constexpr(std::is_same_v<type, formatters::precised<double>>)
+                return binary_kind::precised;
+            else if constexpr(std::is_same_v<type, formatters::fixed<std::int32_t>>)
+                return binary_kind::fixed_i32;
+            else if constexpr(std::is_same_v<type, formatters::fixed<std::uint32_t>>)
+                return binary_kind::fixed_u32;
+            else if constexpr(std::is_same_v<type, formatters::fixed<std::int64_t>>)
+                return binary_kind::fixed_i64;
+            else if constexpr(std::is_same_v<type, formatters::fixed<std::uint64_t>>)
+                return binary_kind::fixed_u64;
+            else if constexpr(std::is_array_v<type> || std::is_same_v<type, char const*>
+                              || requires(type const& v) { std::string_view{v.data(), v.size()}; })
+                return binary_kind::string;
+            else
+                static_assert(sizeof(T) == 0, "unsupported binary log argument");
+        }
+
+
+        template<typename T>
+        std::string_view string_of(T const& value) noexcept {
+            if constexpr(is_literal<T>)
+                return std::string_view{value.value, sizeof(value.value) - 1};
+            else if constexpr(std::is_array_v<T>)
+                return std::string_view{value, std::extent_v<T> - 1};
+            else if constexpr(std::is_pointer_v<T>)
+                return std::string_view{value};
+            else
+                return std::string_view{value.data(), value.size()};
+        }
+
+
+        template<typename Arg>
+        void describe(site& s, std::remove_reference_t<Arg> const& arg) {
+            if constexpr(is_literal<Arg>) {
+                s.kinds.push_back(binary_kind::literal);
+                s.literals.emplace_back(string_of(arg));
+            } else {
+                s.kinds.push_back(kind_of<Arg>());
+            }
+        }
+
+
+        template<typename... Args>
+        site const& register_site(Args&&... args) {
+            auto created = std::make_unique<site>();
+            (describe<Args>(*created, args), ...);
+            std::unique_lock g{registry_sync};
+            created->id = std::uint32_t(registry.size());
+            registry.push_back(std::move(created));
+            return *registry.back();
+        }
+
+
+        template<typename Arg>
+        std::size_t encoded_size(std::remove_reference_t<Arg> const& arg) noexcept {
+            using type = std::remove_cvref_t<Arg>;
+            if constexpr(is_literal<Arg>)
+                return 0;
+            else if constexpr(kind_of<type>() == binary_kind::string)
+                return sizeof(std::uint32_t) + string_of(arg).size();
+            else if constexpr(kind_of<type>() == binary_kind::precised)
+                return sizeof(double) + sizeof(std::int32_t);
+            else if constexpr(std::is_arithmetic_v<type>)
+                return sizeof(type);
+            else
+                return sizeof(arg.value) + sizeof(std::uint32_t);
+        }
+
+
+        inline char* put(char* p, void const* data, std::size_t size) noexcept {
+            std::memcpy(p, data, size);
+            return p + size;
+        }
+
+
+        template<typename Arg>
+        char* encode(char* p, std::remove_reference_t<Arg> const& arg) noexcept {
+            using type = std::remove_cvref_t<Arg>;
+            if constexpr(is_literal<Arg>) {
+                return p;
+            } else if constexpr(kind_of<type>() == binary_kind::string) {
+                auto const sv = string_of(arg);
+                auto const size = std::uint32_t(sv.size());
+                p = put(p, &size, sizeof(size));
+                return put(p, sv.data(), sv.size());
+            } else if constexpr(kind_of<type>() == binary_kind::precised) {
+                auto const precision = std::int32_t(arg.precision);
+                p = put(p, &arg.value, sizeof(arg.value));
+                return put(p, &precision, sizeof(precision));
+            } else if constexpr(std::is_arithmetic_v<type>) {
+                return put(p, &arg, sizeof(arg));
+            } else {
+                auto const width = std::uint32_t(arg.width);
+                p = put(p, &arg.value, sizeof(arg.value));
+                return put(p, &width, sizeof(width));
+            }
+        }
+
+
+        class reader {
+            char const* p_;
+            char const* end_;
+
+        public:
+
+            reader(char const* p, char const* end) noexcept: p_{p}, end_{end} { }
+
+            bool empty() const noexcept { return p_ == end_; }
+            std::size_t left() const noexcept { return std::size_t(end_ - p_); }
+
+            template<typename T>
+            bool get(T& value) noexcept {
+                if(std::size_t(end_ - p_) < sizeof(T))
+                    return false;
+                std::memcpy(&value, p_, sizeof(T));
+                p_ += sizeof(T);
+                return true;
+            }
+
+            bool get(std::string_view& value, std::size_t size) noexcept {
+                if(std::size_t(end_ - p_) < size)
+                    return false;
+                value = std::string_view{p_, size};
+                p_ += size;
+                return true;
+            }
+        }; // reader
+
+
+        template<typename T, class S>
+        bool decode_fixed(reader& r, basic_text<S>& out) {
+            T value;
+            std::uint32_t width;
+            if(!r.get(value) || !r.get(width))
+                return false;
+            out << formatters::fixed<T>{value, width};
+            return true;
+        }
+
+
+        template<class S>
+        bool decode_argument(reader& r, binary_kind kind, basic_text<S>& out) {
+            switch(kind) {
+            case binary_kind::character: {
+                char value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::i32: {
+                std::int32_t value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::u32: {
+                std::uint32_t value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::i64: {
+                std::int64_t value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::u64: {
+                std::uint64_t value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::f32: {
+                float value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::f64: {
+                double value;
+                if(!r.get(value))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::string: {
+                std::uint32_t size;
+                std::string_view value;
+                if(!r.get(size) || !r.get(value, size))
+                    return false;
+                out << value;
+                return true;
+            }
+            case binary_kind::precised: {
+                double value;
+                std::int32_t precision;
+                if(!r.get(value) || !r.get(precision))
+                    return false;
+                out << formatters::precised<double>{value, precision};
+                return true;
+            }
+            case binary_kind::fixed_i32: return decode_fixed<std::int32_t>(r, out);
+            case binary_kind::fixed_u32: return decode_fixed<std::uint32_t>(r, out);
+            case binary_kind::fixed_i64: return decode_fixed<std::int64_t>(r, out);
+            case binary_kind::fixed_u64: return decode_fixed<std::uint64_t>(r, out);
+            default: return false;
+            }
+        }
+
+    } // namespace detail::binary
+
+
+    // File of binary records, descriptors of call sites are written before
+    // the first block that references them
+    class binary_log {
+        int handle_;
+        std::mutex sync_;
+        std::size_t emitted_{0};
+        std::vector<char> descriptors_;
+
+    public:
+
+        explicit binary_log(int handle) noexcept: handle_{handle} { }
+
+        static std::optional<binary_log> create_always(std::string const& path,
+                                                       std::error_code& ec) {
+            auto const opened = ::open(path.data(), O_CREAT | O_TRUNC | O_WRONLY,
+                                       S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            if(!detail::io::write_all(opened, detail::binary::magic,
+                                      sizeof(detail::binary::magic), ec)) {
+                ::close(opened);
+                return std::nullopt;
+            }
+            return std::optional<binary_log>{std::in_place, opened};
+        }
+
+        ~binary_log() { close(); }
+        binary_log(binary_log const&) = delete;
+        binary_log& operator = (binary_log const&) = delete;
+
+
+        explicit operator bool () const noexcept { return handle_ != -1; }
+
+
+        void close() noexcept {
+            if(handle_ == -1)
+                return;
+            ::close(handle_);
+            handle_ = -1;
+        }
+
+
+        bool write_block(char const* data, std::size_t size, std::error_code& ec) {
+            std::unique_lock g{sync_};
+            descriptors_.clear();
+            {
+                std::unique_lock r{detail::binary::registry_sync};
+                for(; emitted_ != detail::binary::registry.size(); ++emitted_)
+                    describe(*detail::binary::registry[emitted_]);
+            }
+            auto const block_size = std::uint32_t(size);
+            ::iovec buffers[] = {
+                {descriptors_.data(), descriptors_.size()},
+                {const_cast<char*>(&detail::binary::records_tag), 1},
+                {const_cast<std::uint32_t*>(&block_size), sizeof(block_size)},
+                {const_cast<char*>(data), size}
+            };
+            return detail::io::write_all(handle_, buffers, std::size(buffers), ec);
+        }
+
+
+    private:
+
+        void append(void const* data, std::size_t size) {
+            auto const* p = static_cast<char const*>(data);
+            descriptors_.insert(descriptors_.end(), p, p + size);
+        }
+
+
+        void describe(detail::binary::site const& s) {
+            auto const count = std::uint32_t(s.kinds.size());
+            append(&detail::binary::descriptor_tag, 1);
+            append(&s.id, sizeof(s.id));
+            append(&count, sizeof(count));
+            auto literal = s.literals.begin();
+            for(auto kind: s.kinds) {
+                append(&kind, sizeof(kind));
+                if(kind != binary_kind::literal)
+                    continue;
+                auto const size = std::uint32_t(literal->size());
+                append(&size, sizeof(size));
+                append(literal->data(), literal->size());
+                ++literal;
+            }
+        }
+    }; // binary_log
+
+
+    // Per-thread buffer of binary records
+    class binary_writer {
+        binary_log* log_;
+        std::unique_ptr<char[]> buffer_;
+        std::size_t capacity_;
+        std::size_t size_{0};
+        std::error_code error_;
+
+    public:
+
+        explicit binary_writer(binary_log& log, std::size_t capacity = 65536)
+            : log_{&log}, buffer_{new char[capacity]}, capacity_{capacity} { }
+
+        ~binary_writer() { flush(); }
+        binary_writer(binary_writer const&) = delete;
+        binary_writer& operator = (binary_writer const&) = delete;
+
+
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        template<typename... Args>
+        void write(detail::binary::site const& s, Args&&... args) {
+            auto const size = sizeof(s.id)
+                + (std::size_t{0} + ... + detail::binary::encoded_size<Args>(args));
+            if(capacity_ - size_ < size) {
+                flush();
+                if(capacity_ < size) {
+                    std::unique_ptr<char[]> record{new char[size]};
+                    encode<Args...>(record.get(), s, args...);
+                    log_->write_block(record.get(), size, error_);
+                    return;
+                }
+            }
+            encode<Args...>(buffer_.get() + size_, s, args...);
+            size_ += size;
+        }
+
+
+        void flush() {
+            if(size_ == 0)
+                return;
+            log_->write_block(buffer_.get(), size_, error_);
+            size_ = 0;
+        }
+
+
+    private:
+
+        template<typename... Args>
+        static void encode(char* p, detail::binary::site const& s,
+                           std::remove_reference_t<Args> const&... args) {
+            p = detail::binary::put(p, &s.id, sizeof(s.id));
+            ((p = detail::binary::encode<Args>(p, args)), ...);
+        }
+    }; // binary_writer
+
+
+    // Turns binary log content back into lines, returns false on malformed input
+    template<class S>
+    bool decode_binary_log(std::string_view content, basic_text<S>& out) {
+        using namespace detail::binary;
+
+        if(content.size() < sizeof(magic)
+           || std::memcmp(content.data(), magic, sizeof(magic)) != 0)
+            return false;
+
+        struct descriptor {
+            std::vector<binary_kind> kinds;
+            std::vector<std::string_view> literals;
+        };
+        std::vector<descriptor> descriptors;
+
+        reader r{content.data() + sizeof(magic), content.data() + content.size()};
+        while(!r.empty()) {
+            char tag;
+            r.get(tag);
+            if(tag == descriptor_tag) {
+                std::uint32_t id, count;
+                // a log describes its call sites in order, once each
+                if(!r.get(id) || !r.get(count) || id != descriptors.size())
+                    return false;
+                // every kind takes a byte, a count beyond the input is garbage
+                if(count > r.left())
+                    return false;
+                auto& d = descriptors.emplace_back();
+                d.kinds.reserve(count);
+                for(std::uint32_t i = 0; i != count; ++i) {
+                    binary_kind kind;
+                    if(!r.get(kind))
+                        return false;
+                    d.kinds.push_back(kind);
+                    if(kind != binary_kind::literal)
+                        continue;
+                    std::uint32_t size;
+                    std::string_view literal;
+                    if(!r.get(size) || !r.get(literal, size))
+                        return false;
+                    d.literals.push_back(literal);
+                }
+            } else if(tag == records_tag) {
+                std::uint32_t size;
+                std::string_view block;
+                if(!r.get(size) || !r.get(block, size))
+                    return false;
+                reader records{block.data(), block.data() + block.size()};
+                while(!records.empty()) {
+                    std::uint32_t id;
+                    if(!records.get(id) || id >= descriptors.size())
+                        return false;
+                    auto const& d = descriptors[id];
+                    auto literal = d.literals.begin();
+                    for(auto kind: d.kinds) {
+                        if(kind == binary_kind::literal)
+                            out << *literal++;
+                        else if(!decode_argument(records, kind, out))
+                            return false;
+                    }
+                    out << '\n';
+                }
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace ufmt
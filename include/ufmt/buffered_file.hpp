@@ -1,112 +1,348 @@
-// This file is part of ufmt library
-// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
-// SPDX-License-Identifier: MIT
- 
-#pragma once
-
-#include <optional>
-#include <string>
-#include <system_error>
-
-#include <errno.h>
-#include <stdio.h>
-
-#include "text.hpp"
-
-
-namespace ufmt {
-	
-	
-	template<class T = text> class buffered_file {
-		
-		text text_;
-		FILE* handle_{nullptr};
-		
-		explicit buffered_file(FILE* handle) noexcept: handle_{handle} { }
-		
-		template<std::size_t N>
-		static std::optional<buffered_file> open(std::string const& path, char const (&mode)[N],
-		                                         std::error_code& ec) {
-			auto* opened = fopen(path.data(), mode);
-			if(!opened) {
-				ec = {errno, std::system_category()};
-				return std::nullopt;
-			}
-			return buffered_file{opened};
-		}
-		
-	public:
-	
-		~buffered_file() noexcept { close(); }
-		buffered_file(buffered_file const&) = delete;
-		buffered_file& operator = (buffered_file const&) = delete;
-		
-		
-		static std::optional<buffered_file> create_always(std::string const& path, std::error_code& ec) {
-			return open(path, "w+b", ec);
-		}
-
-
-		static std::optional<text_file> open_existing(std::string const& path, std::error_code& ec) {
-			return open(path, "wb", ec);
-		}
-		
-		
-		static std::optional<text_file> open_always_to_append(std::string const& path, std::error_code& ec) {
-			return open(path, "a+b", ec);
-		}
-		
-		
-		explicit operator bool () const noexcept {
-			return handle_ != nullptr;
-		}
-		
-		
-		buffered_file(buffered_file&& other) noexcept: handle_{other.handle_} {
-			other.handle_ = nullptr;
-			return *this;
-		}
-		
-		
-		buffered_file& operator = (buffered_file&& other) noexcept {
-			close();
-			handle_ = other.handle_; other.handle_ = nullptr;
-			return *this;
-		}
-	
-		
-		void close() noexcept {
-			if(handle_ == nullptr)
-				return;
-			fclose(handle_);
-			handle_ = nullptr;
-		}
-		
-		
-		bool write(std::string_view sv, std::error_code& ec) noexcept {
-#if defined(_WIN32)
-			if(_fwrite_nolock(text_.data(), text_.size(), sizeof(char), handle_) != text_.size()) {
-#else
-			if(fwrite_unlocked(text_.data(), text_.size(), sizeof(char), handle_) != text_.size()) {
-#endif
-				ec = {errno, std::system_category()};
-				return false;
-			}
-			return true;
-		}
-		
-		
-		template<typename... Args>
-		void print(Args&&... args) {
-			text_.clear();
-			text_.format(std::forward<Args>(args)..., '\n');
-#if defined(_WIN32)
-			_fwrite_nolock(text_.data(), text_.size(), sizeof(char), handle_);
-#else
-			fwrite_unlocked(text_.data(), text_.size(), sizeof(char), handle_);
-#endif
-		}
-	}; // buffered_file
-	
-	
-} // namespace ufmt
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+
+#if defined(_WIN32)
+
+#if !defined(_X86_) && !defined(_AMD64_) && !defined(_ARM_) && !defined(_ARM64_)
+#if defined(_M_IX86)
+#define _X86_
+#elif defined(_M_AMD64)
+#define _AMD64_
+#elif defined(_M_ARM)
+#define _ARM_
+#elif defined(_M_ARM64)
+#define _ARM64_
+#endif
+#endif
+
+#include <minwindef.h>
+#include <fileapi.h>
+#include <handleapi.h>
+#include <errhandlingapi.h>
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io.hpp"
+
+#endif
+
+
+#include "aligned_string.hpp"
+#include "text.hpp"
+#include "write_behind.hpp"
+
+
+namespace ufmt {
+
+
+    // Formats lines straight into its own buffer and writes it out
+    // only when it holds at least buffer_size bytes or on flush().
+    // In write-behind mode a full buffer goes to an I/O thread and
+    // print() blocks only when every buffer is still waiting for disk
+    template<class T = aligned_text> class buffered_file {
+    public:
+
+        static constexpr std::size_t default_buffer_size = 65536;
+
+    private:
+
+#if defined(_WIN32)
+
+        using handle_type = HANDLE;
+
+        static auto constexpr file_write_data = DWORD(2);
+        static auto constexpr file_append_data = DWORD(4);
+        static auto constexpr file_share_read = DWORD(1);
+        static auto constexpr create_always_flag = DWORD(2);
+        static auto constexpr open_existing_flag = DWORD(3);
+        static auto constexpr open_always_flag = DWORD(4);
+        static auto constexpr file_attribute_normal = DWORD(0x80);
+
+        static inline handle_type const invalid_handle = INVALID_HANDLE_VALUE;
+
+#else
+
+        using handle_type = int;
+
+        static constexpr handle_type invalid_handle = -1;
+
+#endif
+
+        struct file_writer {
+            handle_type handle;
+
+            bool operator()(char const* data, std::size_t size, std::error_code& ec) const noexcept {
+                return write_through(handle, data, size, ec);
+            }
+        }; // file_writer
+
+        using writer_type = detail::write_behind<T, file_writer>;
+
+        T text_;
+        handle_type handle_{invalid_handle};
+        std::size_t buffer_size_;
+        std::unique_ptr<writer_type> writer_;
+        std::uint64_t stalls_{0};
+        std::chrono::steady_clock::duration stall_time_{};
+        std::error_code error_;
+
+        buffered_file(handle_type handle, std::size_t buffer_size, unsigned write_behind)
+            : handle_{handle}, buffer_size_{buffer_size == 0 ? 1 : buffer_size} {
+            if(write_behind == 0)
+                text_.reserve(buffer_size_);
+            else
+                writer_ = std::make_unique<writer_type>(write_behind, buffer_size_,
+                                                        file_writer{handle});
+        }
+
+#if defined(_WIN32)
+
+        static std::optional<buffered_file> open(std::string const& path, DWORD desired_access,
+                                                 DWORD creation_disposition,
+                                                 std::size_t buffer_size, unsigned write_behind,
+                                                 std::error_code& ec) {
+            auto const created = CreateFileA(path.data(), desired_access, file_share_read,
+                                             nullptr, creation_disposition,
+                                             file_attribute_normal, nullptr);
+            if(created == INVALID_HANDLE_VALUE) {
+                ec = {int(GetLastError()), std::system_category()};
+                return std::nullopt;
+            }
+            return buffered_file{created, buffer_size, write_behind};
+        }
+
+#else
+
+        static std::optional<buffered_file> open(std::string const& path, int flags,
+                                                 std::size_t buffer_size, unsigned write_behind,
+                                                 std::error_code& ec) {
+            auto const opened = ::open(path.data(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            return buffered_file{opened, buffer_size, write_behind};
+        }
+
+#endif
+
+    public:
+
+        // write_behind is the number of buffers shared with an I/O thread,
+        // 0 writes from the calling thread
+        static std::optional<buffered_file> create_always(std::string const& path,
+                                                          std::error_code& ec,
+                                                          std::size_t buffer_size = default_buffer_size,
+                                                          unsigned write_behind = 0) {
+#if defined(_WIN32)
+            return open(path, file_write_data, create_always_flag, buffer_size, write_behind, ec);
+#else
+            return open(path, O_CREAT | O_TRUNC | O_WRONLY, buffer_size, write_behind, ec);
+#endif
+        }
+
+
+        static std::optional<buffered_file> open_existing(std::string const& path,
+                                                          std::error_code& ec,
+                                                          std::size_t buffer_size = default_buffer_size,
+                                                          unsigned write_behind = 0) {
+#if defined(_WIN32)
+            return open(path, file_write_data, open_existing_flag, buffer_size, write_behind, ec);
+#else
+            return open(path, O_WRONLY, buffer_size, write_behind, ec);
+#endif
+        }
+
+
+        static std::optional<buffered_file> open_always_to_append(std::string const& path,
+                                                                  std::error_code& ec,
+                                                                  std::size_t buffer_size = default_buffer_size,
+                                                                  unsigned write_behind = 0) {
+#if defined(_WIN32)
+            return open(path, file_append_data, open_always_flag, buffer_size, write_behind, ec);
+#else
+            return open(path, O_CREAT | O_APPEND | O_WRONLY, buffer_size, write_behind, ec);
+#endif
+        }
+
+
+        ~buffered_file() noexcept { close(); }
+        buffered_file(buffered_file const&) = delete;
+        buffered_file& operator = (buffered_file const&) = delete;
+
+
+        buffered_file(buffered_file&& other) noexcept
+            : text_{std::move(other.text_)},
+              handle_{std::exchange(other.handle_, invalid_handle)},
+              buffer_size_{other.buffer_size_},
+              writer_{std::move(other.writer_)},
+              stalls_{other.stalls_},
+              stall_time_{other.stall_time_},
+              error_{other.error_} { }
+
+
+        buffered_file& operator = (buffered_file&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            text_ = std::move(other.text_);
+            handle_ = std::exchange(other.handle_, invalid_handle);
+            buffer_size_ = other.buffer_size_;
+            writer_ = std::move(other.writer_);
+            stalls_ = other.stalls_;
+            stall_time_ = other.stall_time_;
+            error_ = other.error_;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept {
+            return handle_ != invalid_handle;
+        }
+
+
+        std::size_t buffer_size() const noexcept { return buffer_size_; }
+
+        std::size_t buffered() const noexcept {
+            return writer_ ? writer_->current().size() : text_.size();
+        }
+
+        // Number of write-behind buffers, 0 in synchronous mode
+        std::size_t write_behind() const noexcept { return writer_ ? writer_->buffers() : 0; }
+
+        // Times print() found every write-behind buffer full and the total wait,
+        // kept after close()
+        std::uint64_t stalls() const noexcept { return writer_ ? writer_->stalls() : stalls_; }
+
+        std::chrono::steady_clock::duration stall_time() const noexcept {
+            return writer_ ? writer_->stall_time() : stall_time_;
+        }
+
+        // Last failure of an implicit flush from print()
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        void close() noexcept {
+            if(handle_ == invalid_handle)
+                return;
+            flush(error_);
+            if(writer_) {
+                stalls_ = writer_->stalls();
+                stall_time_ = writer_->stall_time();
+                writer_.reset();
+            }
+#if defined(_WIN32)
+            CloseHandle(handle_);
+#else
+            ::close(handle_);
+#endif
+            handle_ = invalid_handle;
+        }
+
+
+        // Waits for the I/O thread in write-behind mode
+        bool flush(std::error_code& ec) noexcept {
+            if(writer_) {
+                if(!writer_->current().empty())
+                    writer_->submit(writer_->current().size());
+                writer_->drain();
+                if(!writer_->error())
+                    return true;
+                ec = writer_->error();
+                return false;
+            }
+            if(text_.empty())
+                return true;
+            auto const written = write_through(handle_, text_.data(), text_.size(), ec);
+            text_.clear();
+            return written;
+        }
+
+
+        bool flush() noexcept {
+            return flush(error_);
+        }
+
+
+        bool write(std::string_view sv, std::error_code& ec) noexcept {
+            if(current().size() + sv.size() > current().capacity()) {
+                if(writer_) {
+                    if(!current().empty())
+                        submit(ec);
+                } else {
+                    if(!flush(ec))
+                        return false;
+                    if(sv.size() >= buffer_size_)
+                        return write_through(handle_, sv.data(), sv.size(), ec);
+                }
+            }
+            auto& text = current();
+            text.append(sv.data(), sv.size());
+            if(text.size() >= buffer_size_)
+                return submit(ec);
+            return true;
+        }
+
+
+        template<typename... Args>
+        void print(Args&&... args) {
+            auto& text = current();
+            text.format(std::forward<Args>(args)..., '\n');
+            if(text.size() >= buffer_size_)
+                submit(error_);
+        }
+
+
+    private:
+
+        T& current() noexcept { return writer_ ? writer_->current() : text_; }
+
+
+        // Hands a full buffer to the I/O thread or writes it out
+        bool submit(std::error_code& ec) noexcept {
+            if(!writer_)
+                return flush(ec);
+            writer_->submit(writer_->current().size());
+            return true;
+        }
+
+
+        static bool write_through(handle_type handle, char const* data, std::size_t size,
+                                  std::error_code& ec) noexcept {
+#if defined(_WIN32)
+            while(size != 0) {
+                DWORD written = 0;
+                if(!WriteFile(handle, data, DWORD(size), &written, nullptr)) {
+                    ec = {int(GetLastError()), std::system_category()};
+                    return false;
+                }
+                data += written;
+                size -= written;
+            }
+            return true;
+#else
+            return detail::io::write_all(handle, data, size, ec);
+#endif
+        }
+    }; // buffered_file
+
+} // namespace ufmt
@@ -0,0 +1,296 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "async_print.hpp"
+#include "io.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct datagram_options {
+        std::size_t batch{32};                              // records per sendmmsg
+        std::chrono::milliseconds flush_interval{100};      // send records older than this on write
+        backpressure overflow{backpressure::block};         // on EAGAIN wait or drop the batch
+        bool background_flush{false};                       // send old records without new writes
+    }; // datagram_options
+
+
+    // Unix datagram socket sending one datagram per record, records are
+    // gathered and submitted with one sendmmsg. Used by one thread at a time,
+    // with background_flush that thread shares the sink with a timer under a mutex
+    class datagram_sink {
+        using clock = std::chrono::steady_clock;
+
+        struct timer {
+            std::mutex sync;
+            std::condition_variable wakeup;
+            bool stopping{false};
+            datagram_sink* owner;
+            std::thread thread;
+        }; // timer
+
+        int fd_{-1};
+        datagram_options options_;
+        std::vector<text> records_;
+        std::vector<::iovec> buffers_;
+        std::vector<::mmsghdr> messages_;
+        std::size_t pending_{0};
+        clock::time_point oldest_;
+        std::uint64_t batches_{0};
+        std::uint64_t dropped_{0};
+        std::error_code error_;
+        std::unique_ptr<timer> timer_;
+
+    public:
+
+        static std::optional<datagram_sink> connect(std::string const& path, std::error_code& ec,
+                                                    datagram_options const& options = {}) {
+            ::sockaddr_un address{};
+            if(path.size() >= sizeof(address.sun_path)) {
+                ec = std::make_error_code(std::errc::filename_too_long);
+                return std::nullopt;
+            }
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.data(), path.size());
+            auto const opened = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            if(::connect(opened, reinterpret_cast<::sockaddr const*>(&address),
+                         sizeof(address)) == -1) {
+                ec = {errno, std::system_category()};
+                ::close(opened);
+                return std::nullopt;
+            }
+            return datagram_sink{opened, options};
+        }
+
+
+        // Takes ownership of a connected datagram socket
+        explicit datagram_sink(int fd, datagram_options const& options = {})
+            : fd_{fd}, options_{options},
+              records_(options.batch == 0 ? 1 : options.batch),
+              buffers_(records_.size()),
+              messages_(records_.size()) {
+            if(!options.background_flush)
+                return;
+            timer_ = std::make_unique<timer>();
+            timer_->owner = this;
+            timer_->thread = std::thread{[t = timer_.get()] { run_timer(*t); }};
+        }
+
+        ~datagram_sink() noexcept { close(); }
+        datagram_sink(datagram_sink const&) = delete;
+        datagram_sink& operator = (datagram_sink const&) = delete;
+
+
+        datagram_sink(datagram_sink&& other) noexcept { *this = std::move(other); }
+
+
+        // The timer keeps running and follows the records to this sink
+        datagram_sink& operator = (datagram_sink&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            std::unique_lock<std::mutex> g;
+            if(other.timer_)
+                g = std::unique_lock{other.timer_->sync};
+            fd_ = std::exchange(other.fd_, -1);
+            options_ = other.options_;
+            records_ = std::move(other.records_);
+            buffers_ = std::move(other.buffers_);
+            messages_ = std::move(other.messages_);
+            pending_ = std::exchange(other.pending_, 0);
+            oldest_ = other.oldest_;
+            batches_ = other.batches_;
+            dropped_ = other.dropped_;
+            error_ = other.error_;
+            timer_ = std::move(other.timer_);
+            if(timer_)
+                timer_->owner = this;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return fd_ != -1; }
+
+        std::size_t pending() const noexcept {
+            auto g = lock();
+            return pending_;
+        }
+
+        // Number of sendmmsg calls that sent something
+        std::uint64_t batches() const noexcept {
+            auto g = lock();
+            return batches_;
+        }
+
+        // Records discarded on EAGAIN with a drop policy or refused by the socket
+        std::uint64_t dropped() const noexcept {
+            auto g = lock();
+            return dropped_;
+        }
+
+        // Last failure of an implicit flush
+        std::error_code error() const noexcept {
+            auto g = lock();
+            return error_;
+        }
+
+
+        void close() noexcept {
+            stop_timer();
+            if(fd_ == -1)
+                return;
+            send(error_);
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+
+        bool write(std::string_view sv, std::error_code& ec) {
+            auto g = lock();
+            auto& record = next();
+            record.append(sv.data(), sv.size());
+            return added(ec);
+        }
+
+
+        // Formats straight into the record, without trailing newline
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto g = lock();
+            next().format(std::forward<Args>(args)...);
+            return added(error_);
+        }
+
+
+        bool flush() noexcept {
+            auto g = lock();
+            return send(error_);
+        }
+
+
+        bool flush(std::error_code& ec) noexcept {
+            auto g = lock();
+            return send(ec);
+        }
+
+
+    private:
+
+        std::unique_lock<std::mutex> lock() const noexcept {
+            if(!timer_)
+                return {};
+            return std::unique_lock{timer_->sync};
+        }
+
+
+        bool send(std::error_code& ec) noexcept {
+            for(std::size_t i = 0; i != pending_; ++i) {
+                buffers_[i] = ::iovec{const_cast<char*>(records_[i].data()), records_[i].size()};
+                messages_[i] = ::mmsghdr{};
+                messages_[i].msg_hdr.msg_iov = &buffers_[i];
+                messages_[i].msg_hdr.msg_iovlen = 1;
+            }
+            auto ok = true;
+            for(std::size_t sent = 0; sent != pending_;) {
+                auto const n = ::sendmmsg(fd_, messages_.data() + sent, unsigned(pending_ - sent), 0);
+                if(n > 0) {
+                    ++batches_;
+                    sent += std::size_t(n);
+                    continue;
+                }
+                if(errno == EINTR)
+                    continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if(options_.overflow == backpressure::block) {
+                        if(detail::io::wait_writable(fd_, ec))
+                            continue;
+                    } else {
+                        ec = {errno, std::system_category()};
+                    }
+                    dropped_ += pending_ - sent;
+                    ok = false;
+                    break;
+                }
+                // the first record of the rest is refused, EMSGSIZE for example
+                ec = {errno, std::system_category()};
+                ++dropped_;
+                ++sent;
+                ok = false;
+            }
+            pending_ = 0;
+            return ok;
+        }
+
+
+        text& next() {
+            if(pending_ == 0)
+                oldest_ = clock::now();
+            auto& record = records_[pending_++];
+            record.clear();
+            return record;
+        }
+
+
+        bool added(std::error_code& ec) {
+            if(pending_ == records_.size()
+               || clock::now() - oldest_ >= options_.flush_interval)
+                return send(ec);
+            return true;
+        }
+
+
+        static void run_timer(timer& t) {
+            std::unique_lock g{t.sync};
+            while(!t.stopping) {
+                t.wakeup.wait_for(g, t.owner->options_.flush_interval);
+                auto& sink = *t.owner;
+                if(sink.pending_ != 0 && clock::now() - sink.oldest_ >= sink.options_.flush_interval)
+                    sink.send(sink.error_);
+            }
+        }
+
+
+        void stop_timer() noexcept {
+            if(!timer_)
+                return;
+            {
+                std::unique_lock g{timer_->sync};
+                timer_->stopping = true;
+            }
+            timer_->wakeup.notify_one();
+            timer_->thread.join();
+            timer_.reset();
+        }
+    }; // datagram_sink
+
+} // namespace ufmt
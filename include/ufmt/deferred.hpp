@@ -0,0 +1,359 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <ufmt/fixed_string.hpp>
+#include <ufmt/text.hpp>
+
+
+namespace ufmt {
+
+
+    // How strings longer than the inline capacity are captured:
+    // by reference (caller keeps them alive until render) or by heap copy
+    enum class string_capture { reference, copy };
+
+
+    namespace detail::deferred {
+
+        constexpr std::size_t inline_string_capacity = 20;
+
+
+        template<string_capture P>
+        class captured_string;
+
+
+        template<>
+        class captured_string<string_capture::reference> {
+            char const* external_{nullptr};
+            std::uint32_t size_{0};
+            char inline_[inline_string_capacity];
+
+        public:
+
+            explicit captured_string(std::string_view sv) noexcept
+                : size_{std::uint32_t(sv.size())} {
+                if(sv.size() <= inline_string_capacity)
+                    std::memcpy(inline_, sv.data(), sv.size());
+                else
+                    external_ = sv.data();
+            }
+
+            std::string_view view() const noexcept {
+                return {external_ ? external_ : inline_, size_};
+            }
+        }; // captured_string
+
+
+        template<>
+        class captured_string<string_capture::copy> {
+            std::unique_ptr<char[]> external_;
+            std::uint32_t size_{0};
+            char inline_[inline_string_capacity];
+
+        public:
+
+            explicit captured_string(std::string_view sv)
+                : size_{std::uint32_t(sv.size())} {
+                if(sv.size() <= inline_string_capacity) {
+                    std::memcpy(inline_, sv.data(), sv.size());
+                } else {
+                    external_.reset(new char[sv.size()]);
+                    std::memcpy(external_.get(), sv.data(), sv.size());
+                }
+            }
+
+            std::string_view view() const noexcept {
+                return {external_ ? external_.get() : inline_, size_};
+            }
+        }; // captured_string
+
+
+        template<typename T>
+        struct is_string : std::false_type {};
+
+        template<>
+        struct is_string<std::string> : std::true_type {};
+
+        template<>
+        struct is_string<std::string_view> : std::true_type {};
+
+        template<std::size_t N>
+        struct is_string<fixed_string<N>> : std::true_type {};
+
+        template<typename S>
+        struct is_string<basic_text<S>> : std::true_type {};
+
+        template<std::size_t N>
+        struct is_string<char[N]> : std::true_type {};
+
+        template<>
+        struct is_string<char const*> : std::true_type {};
+
+        template<>
+        struct is_string<char*> : std::true_type {};
+
+
+        // textize() puts only these types into double quotes
+        template<typename T>
+        constexpr bool is_textized_quoted = is_string<T>::value
+                                            && !std::is_array_v<T>
+                                            && !std::is_pointer_v<T>;
+
+        template<>
+        constexpr bool is_textized_quoted<char> = true;
+
+
+        template<typename T>
+        std::string_view string_view_of(T const& value) noexcept {
+            if constexpr(std::is_array_v<T>)
+                return {value, std::extent_v<T> - 1};
+            else if constexpr(std::is_pointer_v<T>)
+                return std::string_view{value};
+            else
+                return std::string_view{value.data(), value.size()};
+        }
+
+
+        template<typename T, string_capture P, typename = void>
+        class captured {
+            static_assert(std::is_trivially_copyable_v<T>,
+                          "deferred argument should be trivially copyable");
+            T value_;
+
+        public:
+
+            explicit captured(T const& value) noexcept: value_{value} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                text << value_;
+            }
+        }; // captured
+
+
+        template<typename T, string_capture P>
+        class captured<T, P, std::enable_if_t<is_string<T>::value>> {
+            captured_string<P> value_;
+
+        public:
+
+            explicit captured(T const& value): value_{string_view_of(value)} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                text << value_.view();
+            }
+        }; // captured
+
+
+        template<class S, typename T, string_capture P>
+        basic_text<S>& operator << (basic_text<S>& self, captured<T, P> const& c) {
+            c.render(self);
+            return self;
+        }
+
+
+        template<typename T, string_capture P>
+        class captured<formatters::left<T>, P> {
+            captured<T, P> value_;
+            unsigned width_;
+
+        public:
+
+            explicit captured(formatters::left<T> const& l)
+                : value_{l.value}, width_{l.width} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                text << formatters::left<captured<T, P>>{value_, width_};
+            }
+        }; // captured
+
+
+        template<typename T, string_capture P>
+        class captured<formatters::right<T>, P> {
+            captured<T, P> value_;
+            unsigned width_;
+
+        public:
+
+            explicit captured(formatters::right<T> const& r)
+                : value_{r.value}, width_{r.width} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                text << formatters::right<captured<T, P>>{value_, width_};
+            }
+        }; // captured
+
+
+        template<typename T, string_capture P>
+        class captured<formatters::quoted<T>, P> {
+            captured<T, P> value_;
+
+        public:
+
+            explicit captured(formatters::quoted<T> const& q): value_{q.value} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                text << formatters::quoted<captured<T, P>>{value_};
+            }
+        }; // captured
+
+
+        template<typename T, string_capture P>
+        class captured<formatters::dquoted<T>, P> {
+            captured<T, P> value_;
+
+        public:
+
+            explicit captured(formatters::dquoted<T> const& q): value_{q.value} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                text << formatters::dquoted<captured<T, P>>{value_};
+            }
+        }; // captured
+
+
+        template<typename T, string_capture P>
+        class captured<formatters::textize<T>, P> {
+            captured<T, P> value_;
+
+        public:
+
+            explicit captured(formatters::textize<T> const& t): value_{t.value} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                if constexpr(is_textized_quoted<T>)
+                    text << '\"' << value_ << '\"';
+                else
+                    text << value_;
+            }
+        }; // captured
+
+
+        template<typename... Cs>
+        struct pack;
+
+
+        template<>
+        struct pack<> {
+            template<class S>
+            void render(basic_text<S>&) const { }
+        }; // pack
+
+
+        template<typename C, typename... Cs>
+        struct pack<C, Cs...> {
+            C head;
+            pack<Cs...> tail;
+
+            template<typename Arg, typename... Args>
+            explicit pack(Arg const& arg, Args const&... args)
+                : head{arg}, tail{args...} { }
+
+            template<class S>
+            void render(basic_text<S>& text) const {
+                head.render(text);
+                tail.render(text);
+            }
+        }; // pack
+
+    } // namespace detail::deferred
+
+
+    template<string_capture P, typename... Args>
+    class basic_deferred {
+        detail::deferred::pack<detail::deferred::captured<Args, P>...> pack_;
+
+    public:
+
+        template<typename... Xs>
+        explicit basic_deferred(Xs const&... args): pack_{args...} { }
+
+        template<class S>
+        void render(basic_text<S>& text) const {
+            pack_.render(text);
+        }
+    }; // basic_deferred
+
+
+    template<typename... Args>
+    using deferred = basic_deferred<string_capture::reference, Args...>;
+
+
+    template<typename... Args>
+    deferred<std::remove_cvref_t<Args>...> defer(Args const&... args) noexcept {
+        return deferred<std::remove_cvref_t<Args>...>{args...};
+    }
+
+
+    template<typename... Args>
+    basic_deferred<string_capture::copy, std::remove_cvref_t<Args>...>
+    defer_copy(Args const&... args) {
+        return basic_deferred<string_capture::copy, std::remove_cvref_t<Args>...>{args...};
+    }
+
+
+    template<class S, std::size_t Capacity>
+    class basic_deferred_message {
+        using render_function = void (*)(void const*, basic_text<S>&);
+
+        render_function render_{nullptr};
+        alignas(void*) unsigned char storage_[Capacity];
+
+        template<class D>
+        static void render_as(void const* p, basic_text<S>& text) {
+            std::launder(static_cast<D const*>(p))->render(text);
+        }
+
+    public:
+
+        static constexpr std::size_t capacity = Capacity;
+
+
+        template<typename... Args>
+        static basic_deferred_message of(Args const&... args) noexcept {
+            using deferred_type = deferred<std::remove_cvref_t<Args>...>;
+            static_assert(std::is_trivially_copyable_v<deferred_type>,
+                          "deferred arguments should be trivially copyable");
+            static_assert(sizeof(deferred_type) <= Capacity,
+                          "deferred arguments are too large for the message");
+            static_assert(alignof(deferred_type) <= alignof(void*),
+                          "deferred arguments are overaligned for the message");
+            basic_deferred_message m;
+            ::new(static_cast<void*>(m.storage_)) deferred_type{args...};
+            m.render_ = &render_as<deferred_type>;
+            return m;
+        }
+
+
+        bool empty() const noexcept { return render_ == nullptr; }
+
+
+        void render(basic_text<S>& text) const {
+            if(render_ != nullptr)
+                render_(storage_, text);
+        }
+    }; // basic_deferred_message
+
+
+    using deferred_message = basic_deferred_message<std::string, 256 - sizeof(void*)>;
+
+} // namespace ufmt
@@ -0,0 +1,179 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "aligned_string.hpp"
+#include "io.hpp"
+#include "text.hpp"
+#include "write_behind.hpp"
+
+
+namespace ufmt {
+
+
+    struct direct_options {
+        std::size_t buffer_size{std::size_t(1) << 20};   // rounded up to whole blocks
+        unsigned buffers{2};
+    }; // direct_options
+
+
+    // Writes whole 4 KiB blocks with O_DIRECT from a background thread
+    // bypassing the page cache, only the final partial block goes through it
+    class direct_text_file {
+    public:
+
+        static constexpr std::size_t block_size = 4096;
+
+    private:
+
+        struct block_writer {
+            int handle;
+
+            bool operator()(char const* data, std::size_t size, std::error_code& ec) const noexcept {
+                return detail::io::write_all(handle, data, size, ec);
+            }
+        }; // block_writer
+
+        using writer_type = detail::write_behind<aligned_text, block_writer>;
+
+        int handle_{-1};
+        bool direct_{false};
+        std::size_t buffer_size_;
+        std::unique_ptr<writer_type> writer_;
+        aligned_text* current_;
+        std::error_code error_;
+
+        direct_text_file(int handle, bool direct, direct_options const& options)
+            : handle_{handle}, direct_{direct},
+              buffer_size_{options.buffer_size <= block_size
+                           ? block_size
+                           : (options.buffer_size + block_size - 1) / block_size * block_size},
+              writer_{std::make_unique<writer_type>(options.buffers, buffer_size_ + block_size,
+                                                    block_writer{handle})},
+              current_{&writer_->current()} { }
+
+    public:
+
+        // Falls back to the page cache where O_DIRECT is not supported
+        static std::optional<direct_text_file> create_always(std::string const& path,
+                                                             std::error_code& ec,
+                                                             direct_options const& options = {}) {
+            auto const flags = O_CREAT | O_TRUNC | O_WRONLY;
+            auto const mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+            auto direct = true;
+            auto opened = ::open(path.data(), flags | O_DIRECT, mode);
+            if(opened == -1 && errno == EINVAL) {
+                direct = false;
+                opened = ::open(path.data(), flags, mode);
+            }
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            return direct_text_file{opened, direct, options};
+        }
+
+
+        ~direct_text_file() noexcept { close(); }
+        direct_text_file(direct_text_file const&) = delete;
+        direct_text_file& operator = (direct_text_file const&) = delete;
+
+
+        direct_text_file(direct_text_file&& other) noexcept
+            : handle_{std::exchange(other.handle_, -1)},
+              direct_{other.direct_},
+              buffer_size_{other.buffer_size_},
+              writer_{std::move(other.writer_)},
+              current_{other.current_},
+              error_{other.error_} { }
+
+
+        direct_text_file& operator = (direct_text_file&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            handle_ = std::exchange(other.handle_, -1);
+            direct_ = other.direct_;
+            buffer_size_ = other.buffer_size_;
+            writer_ = std::move(other.writer_);
+            current_ = other.current_;
+            error_ = other.error_;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return handle_ != -1; }
+
+        // False when the file system refused O_DIRECT
+        bool direct() const noexcept { return direct_; }
+
+        // Times print() waited for the writer thread
+        std::uint64_t stalls() const noexcept { return writer_ ? writer_->stalls() : 0; }
+
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        // Writes the remaining partial block through the page cache
+        void close() noexcept {
+            if(handle_ == -1)
+                return;
+            writer_->stop();
+            if(!error_)
+                error_ = writer_->error();
+            if(!current_->empty()) {
+                if(direct_)
+                    ::fcntl(handle_, F_SETFL, ::fcntl(handle_, F_GETFL) & ~O_DIRECT);
+                std::error_code ec;
+                if(!detail::io::write_all(handle_, current_->data(), current_->size(), ec)
+                   && !error_)
+                    error_ = ec;
+            }
+            writer_.reset();
+            ::close(handle_);
+            handle_ = -1;
+        }
+
+
+        void write(std::string_view sv) {
+            current_->append(sv.data(), sv.size());
+            if(current_->size() >= buffer_size_)
+                submit();
+        }
+
+
+        template<typename... Args>
+        void print(Args&&... args) {
+            current_->format(std::forward<Args>(args)..., '\n');
+            if(current_->size() >= buffer_size_)
+                submit();
+        }
+
+
+    private:
+
+        // Submits whole blocks and carries the partial one to the next buffer
+        void submit() {
+            auto& filled = *current_;
+            auto const whole = filled.size() / block_size * block_size;
+            current_ = &writer_->submit(whole);
+            current_->append(filled.data() + whole, filled.size() - whole);
+        }
+    }; // direct_text_file
+
+} // namespace ufmt
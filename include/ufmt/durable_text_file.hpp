@@ -0,0 +1,212 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io.hpp"
+#include "print.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    namespace detail::durable {
+
+        // Records are numbered from 1 in the order they enter the buffer,
+        // one fdatasync covers every record appended while the previous one ran
+        struct state {
+            static constexpr auto none = ~std::uint64_t(0);
+
+            int fd{-1};
+            detail::printer::spinlock sync;
+            text pending;
+            std::uint64_t appended{0};
+            std::error_code error;
+
+            alignas(64) std::atomic<std::uint64_t> durable{0};
+            std::atomic<std::uint64_t> failed{none};   // first record of a failed commit
+            std::atomic<std::uint64_t> commits{0};
+            std::atomic<std::uint32_t> signal{0};
+            std::atomic<bool> stopping{false};
+            std::thread thread;
+
+
+            ~state() {
+                stopping.store(true, std::memory_order_release);
+                wake();
+                if(thread.joinable())
+                    thread.join();
+                if(fd != -1)
+                    ::close(fd);
+            }
+
+
+            void wake() noexcept {
+                signal.fetch_add(1, std::memory_order_release);
+                signal.notify_one();
+            }
+
+
+            std::uint64_t append(std::string_view sv) {
+                std::uint64_t sequence;
+                {
+                    std::unique_lock g{sync};
+                    pending.append(sv.data(), sv.size());
+                    sequence = ++appended;
+                }
+                wake();
+                return sequence;
+            }
+
+
+            void run() {
+                text batch;
+                for(;;) {
+                    auto const observed = signal.load(std::memory_order_acquire);
+                    std::uint64_t last;
+                    {
+                        std::unique_lock g{sync};
+                        last = appended;
+                        std::swap(batch, pending);
+                    }
+                    if(last == durable.load(std::memory_order_relaxed)) {
+                        if(stopping.load(std::memory_order_acquire))
+                            return;
+                        signal.wait(observed, std::memory_order_acquire);
+                        continue;
+                    }
+
+                    std::error_code ec;
+                    if(detail::io::write_all(fd, batch.data(), batch.size(), ec)
+                       && ::fdatasync(fd) == -1)
+                        ec = {errno, std::system_category()};
+                    if(ec) {
+                        std::unique_lock g{sync};
+                        error = ec;
+                        if(failed.load(std::memory_order_relaxed) == none)
+                            failed.store(durable.load(std::memory_order_relaxed) + 1,
+                                         std::memory_order_relaxed);
+                    }
+                    batch.clear();
+                    commits.fetch_add(1, std::memory_order_relaxed);
+                    durable.store(last, std::memory_order_release);
+                    durable.notify_all();
+                }
+            }
+        }; // state
+
+
+        inline thread_local text buffer;
+
+    } // namespace detail::durable
+
+
+    // Thread-safe file with group commit: print returns a sequence number,
+    // wait_durable blocks until the record survives a system crash
+    class durable_text_file {
+        std::unique_ptr<detail::durable::state> state_;
+
+        explicit durable_text_file(std::unique_ptr<detail::durable::state> state) noexcept
+            : state_{std::move(state)} { }
+
+        static std::optional<durable_text_file> open(std::string const& path, int flags,
+                                                     std::error_code& ec) {
+            auto const opened = ::open(path.data(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            auto state = std::make_unique<detail::durable::state>();
+            state->fd = opened;
+            auto* raw = state.get();
+            state->thread = std::thread{[raw] { raw->run(); }};
+            return durable_text_file{std::move(state)};
+        }
+
+    public:
+
+        static std::optional<durable_text_file> create_always(std::string const& path,
+                                                              std::error_code& ec) {
+            return open(path, O_CREAT | O_TRUNC | O_WRONLY, ec);
+        }
+
+
+        static std::optional<durable_text_file> open_always_to_append(std::string const& path,
+                                                                      std::error_code& ec) {
+            return open(path, O_CREAT | O_APPEND | O_WRONLY, ec);
+        }
+
+
+        explicit operator bool () const noexcept { return state_ != nullptr; }
+
+
+        // Commits every record and stops the sync thread
+        void close() noexcept { state_.reset(); }
+
+
+        // Number of fdatasync calls so far
+        std::uint64_t commits() const noexcept {
+            return state_->commits.load(std::memory_order_relaxed);
+        }
+
+
+        std::uint64_t durable() const noexcept {
+            return state_->durable.load(std::memory_order_acquire);
+        }
+
+
+        std::error_code error() const {
+            std::unique_lock g{state_->sync};
+            return state_->error;
+        }
+
+
+        std::uint64_t write(std::string_view sv) {
+            return state_->append(sv);
+        }
+
+
+        template<typename... Args>
+        std::uint64_t print(Args&&... args) {
+            auto& line = detail::durable::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+            return state_->append(line.view());
+        }
+
+
+        // False if the commit covering the record failed
+        bool wait_durable(std::uint64_t sequence) const noexcept {
+            auto& durable = state_->durable;
+            for(auto done = durable.load(std::memory_order_acquire); done < sequence;
+                done = durable.load(std::memory_order_acquire))
+                durable.wait(done, std::memory_order_acquire);
+            return sequence < state_->failed.load(std::memory_order_relaxed);
+        }
+
+
+        template<typename... Args>
+        bool print_durable(Args&&... args) {
+            return wait_durable(print(std::forward<Args>(args)...));
+        }
+    }; // durable_text_file
+
+} // namespace ufmt
@@ -0,0 +1,299 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct flight_recorder_options {
+        std::size_t capacity{std::size_t(1) << 20};   // rounded up to whole pages
+    }; // flight_recorder_options
+
+
+    namespace detail::flight {
+
+        constexpr char magic[8] = {'u', 'f', 'm', 't', 'r', 'i', 'n', 'g'};
+        constexpr std::size_t page_size = 4096;
+        constexpr std::size_t header_size = 16;    // sequence, length
+        constexpr std::size_t trailer_size = 8;    // record size to walk back
+
+
+        // First page of the shared memory object, records follow it
+        struct layout {
+            char magic[8];
+            std::uint64_t capacity;
+            std::uint64_t max_record;
+            alignas(64) std::uint64_t head;        // bytes ever written, atomic
+        }; // layout
+
+
+        constexpr std::size_t record_size(std::size_t length) noexcept {
+            return (header_size + length + trailer_size + 7) / 8 * 8;
+        }
+
+
+        inline void store(char* at, std::uint64_t word) noexcept {
+            std::memcpy(at, &word, sizeof(word));
+        }
+
+
+        inline std::string shm_name(std::string const& name) {
+            return name.empty() || name.front() != '/' ? '/' + name : name;
+        }
+
+
+        inline thread_local text buffer;
+
+    } // namespace detail::flight
+
+
+    // Keeps the most recent records in a POSIX shared memory ring that
+    // outlives a crash, records are written by one thread at a time.
+    // The ring is mapped twice in a row, so a record is always contiguous
+    class flight_recorder {
+        int fd_{-1};
+        char* base_{nullptr};
+        std::size_t capacity_{0};
+        std::size_t max_record_{0};
+        std::uint64_t head_{0};
+        std::uint64_t sequence_{0};
+
+        flight_recorder(int fd, char* base, std::size_t capacity) noexcept
+            : fd_{fd}, base_{base}, capacity_{capacity}, max_record_{capacity / 4} { }
+
+        detail::flight::layout& layout() const noexcept {
+            return *reinterpret_cast<detail::flight::layout*>(base_);
+        }
+
+    public:
+
+        // Creates or truncates /dev/shm/name, remove() deletes it
+        static std::optional<flight_recorder> create(std::string const& name, std::error_code& ec,
+                                                     flight_recorder_options const& options = {}) {
+            using namespace detail::flight;
+            auto const capacity = options.capacity <= page_size
+                                  ? page_size
+                                  : (options.capacity + page_size - 1) / page_size * page_size;
+            auto const fd = ::shm_open(shm_name(name).data(), O_CREAT | O_TRUNC | O_RDWR,
+                                       S_IRUSR | S_IWUSR);
+            if(fd == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            auto const fail = [&](void* reserved) {
+                ec = {errno, std::system_category()};
+                if(reserved != MAP_FAILED)
+                    ::munmap(reserved, page_size + 2 * capacity);
+                ::close(fd);
+                return std::nullopt;
+            };
+            if(::ftruncate(fd, ::off_t(page_size + capacity)) == -1)
+                return fail(MAP_FAILED);
+            auto* reserved = ::mmap(nullptr, page_size + 2 * capacity, PROT_NONE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(reserved == MAP_FAILED)
+                return fail(MAP_FAILED);
+            auto* base = static_cast<char*>(reserved);
+            if(::mmap(base, page_size + capacity, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+               || ::mmap(base + page_size + capacity, capacity, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_FIXED, fd, ::off_t(page_size)) == MAP_FAILED)
+                return fail(reserved);
+
+            flight_recorder recorder{fd, base, capacity};
+            auto& l = recorder.layout();
+            l.capacity = capacity;
+            l.max_record = recorder.max_record_;
+            l.head = 0;
+            std::memcpy(l.magic, magic, sizeof(magic));
+            return recorder;
+        }
+
+
+        static bool remove(std::string const& name, std::error_code& ec) noexcept {
+            if(::shm_unlink(detail::flight::shm_name(name).data()) == 0)
+                return true;
+            ec = {errno, std::system_category()};
+            return false;
+        }
+
+
+        ~flight_recorder() noexcept { close(); }
+        flight_recorder(flight_recorder const&) = delete;
+        flight_recorder& operator = (flight_recorder const&) = delete;
+
+
+        flight_recorder(flight_recorder&& other) noexcept
+            : fd_{std::exchange(other.fd_, -1)},
+              base_{std::exchange(other.base_, nullptr)},
+              capacity_{other.capacity_},
+              max_record_{other.max_record_},
+              head_{other.head_},
+              sequence_{other.sequence_} { }
+
+
+        flight_recorder& operator = (flight_recorder&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+            base_ = std::exchange(other.base_, nullptr);
+            capacity_ = other.capacity_;
+            max_record_ = other.max_record_;
+            head_ = other.head_;
+            sequence_ = other.sequence_;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return fd_ != -1; }
+
+        std::size_t capacity() const noexcept { return capacity_; }
+
+        // Sequence number of the last record, records are numbered from 1
+        std::uint64_t sequence() const noexcept { return sequence_; }
+
+
+        // Unmaps the ring, the shared memory object stays for readers
+        void close() noexcept {
+            if(fd_ == -1)
+                return;
+            ::munmap(base_, detail::flight::page_size + 2 * capacity_);
+            ::close(fd_);
+            fd_ = -1;
+            base_ = nullptr;
+        }
+
+
+        // Records longer than a quarter of the ring are truncated
+        bool write(std::string_view sv, std::error_code&) noexcept {
+            using namespace detail::flight;
+            auto const length = std::min(sv.size(), max_record_ - header_size - trailer_size);
+            auto const size = record_size(length);
+            auto* record = base_ + page_size + head_ % capacity_;
+            // seqlock writer: the head published last is visible before
+            // this record overwrites older ones
+            std::atomic_thread_fence(std::memory_order_release);
+            store(record, ++sequence_);
+            store(record + 8, length);
+            std::memcpy(record + header_size, sv.data(), length);
+            store(record + size - trailer_size, size);
+            head_ += size;
+            std::atomic_ref<std::uint64_t>{layout().head}.store(head_, std::memory_order_release);
+            return true;
+        }
+
+
+        template<typename... Args>
+        void print(Args&&... args) {
+            auto& line = detail::flight::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+            std::error_code ec;
+            write(line.view(), ec);
+        }
+    }; // flight_recorder
+
+
+    // Passes the surviving records of a live or crashed recorder to
+    // f(sequence, record) oldest first. Records that the writer may be
+    // overwriting while they are copied are skipped
+    template<typename F>
+    bool read_flight_recorder(std::string const& name, std::error_code& ec, F&& f) {
+        using namespace detail::flight;
+        auto const fd = ::shm_open(shm_name(name).data(), O_RDONLY, 0);
+        if(fd == -1) {
+            ec = {errno, std::system_category()};
+            return false;
+        }
+        struct ::stat st;
+        if(::fstat(fd, &st) == -1) {
+            ec = {errno, std::system_category()};
+            ::close(fd);
+            return false;
+        }
+        if(std::size_t(st.st_size) < 2 * page_size) {
+            ec = std::make_error_code(std::errc::invalid_argument);
+            ::close(fd);
+            return false;
+        }
+        auto* mapped = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(mapped == MAP_FAILED) {
+            ec = {errno, std::system_category()};
+            return false;
+        }
+        auto const* base = static_cast<char const*>(mapped);
+        auto& l = *reinterpret_cast<layout*>(const_cast<char*>(base));
+        auto const capacity = l.capacity;
+        auto const max_record = l.max_record;
+        if(std::memcmp(l.magic, magic, sizeof(magic)) != 0
+           || page_size + capacity != std::uint64_t(st.st_size) || max_record > capacity) {
+            ::munmap(mapped, std::size_t(st.st_size));
+            ec = std::make_error_code(std::errc::invalid_argument);
+            return false;
+        }
+
+        std::atomic_ref<std::uint64_t> head{l.head};
+        auto const end = head.load(std::memory_order_acquire);
+        // twice in a row like the writer sees it
+        std::string ring(2 * capacity, '\0');
+        std::memcpy(ring.data(), base + page_size, capacity);
+        std::memcpy(ring.data() + capacity, ring.data(), capacity);
+        // the copy above completes before head is read again
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto const overwritten = head.load(std::memory_order_relaxed) + max_record;
+        ::munmap(mapped, std::size_t(st.st_size));
+        auto const begin = overwritten > capacity ? overwritten - capacity : 0;
+
+        struct found { std::uint64_t sequence; std::size_t offset, length; };
+        std::vector<found> records;
+        auto const word = [&](std::uint64_t position) {
+            std::uint64_t w;
+            std::memcpy(&w, ring.data() + position % capacity, 8);
+            return w;
+        };
+        for(auto position = end; position >= begin + header_size + trailer_size;) {
+            auto const size = word(position - trailer_size);
+            if(size < header_size + trailer_size || size > max_record || size > position - begin)
+                break;
+            auto const start = position - size;
+            auto const sequence = word(start);
+            auto const length = word(start + 8);
+            if(record_size(length) != size
+               || (!records.empty() && sequence + 1 != records.back().sequence))
+                break;
+            records.push_back({sequence, std::size_t(start % capacity + header_size),
+                               std::size_t(length)});
+            position = start;
+        }
+        for(auto it = records.rbegin(); it != records.rend(); ++it)
+            f(it->sequence, std::string_view{ring.data() + it->offset, it->length});
+        return true;
+    }
+
+} // namespace ufmt
@@ -0,0 +1,157 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include <limits.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+namespace ufmt::detail::io {
+
+
+#if defined(IOV_MAX)
+    constexpr std::size_t max_buffers = IOV_MAX;
+#else
+    constexpr std::size_t max_buffers = 1024;
+#endif
+
+
+    // write, pwrite and writev calls made by this thread, benchmarks read it
+    inline thread_local std::uint64_t system_calls = 0;
+
+
+    // Waits for a non-blocking descriptor to accept more data
+    inline bool wait_writable(int fd, std::error_code& ec) noexcept {
+        pollfd p{fd, POLLOUT, 0};
+        for(;;) {
+            if(::poll(&p, 1, -1) != -1)
+                return true;
+            if(errno == EINTR)
+                continue;
+            ec = {errno, std::system_category()};
+            return false;
+        }
+    }
+
+
+    inline bool write_all(int fd, char const* data, std::size_t size,
+                          std::error_code& ec) noexcept {
+        while(size != 0) {
+            ++system_calls;
+            auto const written = ::write(fd, data, size);
+            if(written == 0) {   // retrying would never make progress
+                ec = std::make_error_code(std::errc::io_error);
+                return false;
+            }
+            if(written == -1) {
+                if(errno == EINTR)
+                    continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if(!wait_writable(fd, ec))
+                        return false;
+                    continue;
+                }
+                ec = {errno, std::system_category()};
+                return false;
+            }
+            data += written;
+            size -= std::size_t(written);
+        }
+        return true;
+    }
+
+
+    // Positional write of the whole range, does not move the file offset
+    inline bool pwrite_all(int fd, char const* data, std::size_t size, std::uint64_t offset,
+                           std::error_code& ec) noexcept {
+        while(size != 0) {
+            ++system_calls;
+            auto const written = ::pwrite(fd, data, size, ::off_t(offset));
+            if(written == 0) {   // retrying would never make progress
+                ec = std::make_error_code(std::errc::io_error);
+                return false;
+            }
+            if(written == -1) {
+                if(errno == EINTR)
+                    continue;
+                ec = {errno, std::system_category()};
+                return false;
+            }
+            data += written;
+            size -= std::size_t(written);
+            offset += std::uint64_t(written);
+        }
+        return true;
+    }
+
+
+    // Writes all buffers resuming after partial writes, buffers are consumed in place
+    inline bool write_all(int fd, ::iovec* buffers, std::size_t count,
+                          std::error_code& ec) noexcept {
+        while(count != 0) {
+            if(buffers->iov_len == 0) {
+                ++buffers;
+                --count;
+                continue;
+            }
+            auto const n = count < max_buffers ? count : max_buffers;
+            ++system_calls;
+            auto written = ::writev(fd, buffers, int(n));
+            if(written == 0) {   // retrying would never make progress
+                ec = std::make_error_code(std::errc::io_error);
+                return false;
+            }
+            if(written == -1) {
+                if(errno == EINTR)
+                    continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if(!wait_writable(fd, ec))
+                        return false;
+                    continue;
+                }
+                ec = {errno, std::system_category()};
+                return false;
+            }
+            while(count != 0 && std::size_t(written) >= buffers->iov_len) {
+                written -= ::ssize_t(buffers->iov_len);
+                ++buffers;
+                --count;
+            }
+            if(written != 0) {
+                buffers->iov_base = static_cast<char*>(buffers->iov_base) + written;
+                buffers->iov_len -= std::size_t(written);
+            }
+        }
+        return true;
+    }
+
+
+
+    // One writev per max_buffers texts, Texts is a range of text pointers.
+    // Buffers are described on the stack, nothing is allocated
+    template<typename Texts>
+    bool write_gathered(int fd, Texts const& texts, std::error_code& ec) noexcept {
+        ::iovec buffers[max_buffers];
+        std::size_t count = 0;
+        for(auto const* t: texts) {
+            buffers[count++] = ::iovec{const_cast<char*>(t->data()), t->size()};
+            if(count != max_buffers)
+                continue;
+            if(!write_all(fd, buffers, count, ec))
+                return false;
+            count = 0;
+        }
+        return write_all(fd, buffers, count, ec);
+    }
+
+} // namespace ufmt::detail::io
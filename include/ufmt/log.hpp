@@ -0,0 +1,110 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <utility>
+
+#include "print.hpp"
+
+
+#define UFMT_LEVEL_DEBUG 0
+#define UFMT_LEVEL_INFO 1
+#define UFMT_LEVEL_WARN 2
+#define UFMT_LEVEL_OFF 3
+
+#if !defined(UFMT_MIN_LEVEL)
+#    define UFMT_MIN_LEVEL UFMT_LEVEL_DEBUG
+#endif
+
+
+// Below the compile-time minimum level these expand to nothing, otherwise
+// arguments are evaluated only when the runtime level allows the line
+#if UFMT_MIN_LEVEL <= UFMT_LEVEL_DEBUG
+#    define UFMT_DEBUG(...)                                                      \
+        (::ufmt::enabled(::ufmt::level::debug) ? ::ufmt::print(__VA_ARGS__) : void())
+#else
+#    define UFMT_DEBUG(...) void()
+#endif
+
+#if UFMT_MIN_LEVEL <= UFMT_LEVEL_INFO
+#    define UFMT_INFO(...)                                                       \
+        (::ufmt::enabled(::ufmt::level::info) ? ::ufmt::print(__VA_ARGS__) : void())
+#else
+#    define UFMT_INFO(...) void()
+#endif
+
+#if UFMT_MIN_LEVEL <= UFMT_LEVEL_WARN
+#    define UFMT_WARN(...)                                                       \
+        (::ufmt::enabled(::ufmt::level::warn) ? ::ufmt::print(__VA_ARGS__) : void())
+#else
+#    define UFMT_WARN(...) void()
+#endif
+
+
+namespace ufmt {
+
+
+    enum class level : int {
+        debug = UFMT_LEVEL_DEBUG,
+        info = UFMT_LEVEL_INFO,
+        warn = UFMT_LEVEL_WARN,
+        off = UFMT_LEVEL_OFF
+    }; // level
+
+
+    constexpr level min_level = level(UFMT_MIN_LEVEL);
+
+
+    namespace detail::log {
+
+        inline std::atomic<level> current{min_level};
+
+    } // namespace detail::log
+
+
+    inline void set_level(level l) noexcept {
+        detail::log::current.store(l, std::memory_order_relaxed);
+    }
+
+
+    inline level get_level() noexcept {
+        return detail::log::current.load(std::memory_order_relaxed);
+    }
+
+
+    inline bool enabled(level l) noexcept {
+        return l >= min_level && l >= detail::log::current.load(std::memory_order_relaxed);
+    }
+
+
+    template<typename... Args>
+    void debug(Args&&... args) {
+        if constexpr(level::debug >= min_level) {
+            if(enabled(level::debug))
+                print(std::forward<Args>(args)...);
+        }
+    }
+
+
+    template<typename... Args>
+    void info(Args&&... args) {
+        if constexpr(level::info >= min_level) {
+            if(enabled(level::info))
+                print(std::forward<Args>(args)...);
+        }
+    }
+
+
+    template<typename... Args>
+    void warn(Args&&... args) {
+        if constexpr(level::warn >= min_level) {
+            if(enabled(level::warn))
+                print(std::forward<Args>(args)...);
+        }
+    }
+
+} // namespace ufmt
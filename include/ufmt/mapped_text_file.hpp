@@ -0,0 +1,387 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct mapped_options {
+        std::size_t window_size{std::size_t(64) << 20};   // mapped and preallocated ahead
+        std::size_t writeback_bytes{0};   // start writeback every that many bytes, 0 leaves it to the kernel
+    }; // mapped_options
+
+
+    namespace detail::mapped {
+
+        inline std::size_t page_size() noexcept {
+            static auto const size = std::size_t(::sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+
+        inline std::uint64_t round_up(std::uint64_t n, std::uint64_t to) noexcept {
+            return (n + to - 1) / to * to;
+        }
+
+
+        // Storage for basic_text living in a shared file mapping,
+        // data() is the window start, size() is the logical end within it
+        class window {
+            int fd_{-1};
+            char* base_{nullptr};
+            std::uint64_t offset_{0};
+            std::size_t size_{0};
+            std::size_t capacity_{0};
+            std::uint64_t allocated_{0};
+            std::error_code error_;
+
+        public:
+
+            using value_type = char;
+            using size_type = std::size_t;
+
+            window() noexcept = default;
+            window(window const&) = delete;
+            window& operator = (window const&) = delete;
+
+            window(window&& other) noexcept
+                : fd_{std::exchange(other.fd_, -1)},
+                  base_{std::exchange(other.base_, nullptr)},
+                  offset_{other.offset_},
+                  size_{std::exchange(other.size_, 0)},
+                  capacity_{std::exchange(other.capacity_, 0)},
+                  allocated_{other.allocated_},
+                  error_{other.error_} { }
+
+            window& operator = (window&& other) noexcept {
+                if(this == &other)
+                    return *this;
+                detach();
+                fd_ = std::exchange(other.fd_, -1);
+                base_ = std::exchange(other.base_, nullptr);
+                offset_ = other.offset_;
+                size_ = std::exchange(other.size_, 0);
+                capacity_ = std::exchange(other.capacity_, 0);
+                allocated_ = other.allocated_;
+                error_ = other.error_;
+                return *this;
+            }
+
+            ~window() { detach(); }
+
+
+            char* data() noexcept { return base_; }
+            char const* data() const noexcept { return base_; }
+            size_type size() const noexcept { return size_; }
+            size_type capacity() const noexcept { return capacity_; }
+            bool empty() const noexcept { return size_ == 0; }
+            void clear() noexcept { size_ = 0; }
+            char& operator[](size_type i) noexcept { return base_[i]; }
+            char operator[](size_type i) const noexcept { return base_[i]; }
+
+            std::uint64_t logical() const noexcept { return offset_ + size_; }
+            std::uint64_t allocated() const noexcept { return allocated_; }
+            std::error_code const& error() const noexcept { return error_; }
+
+
+            // Maps capacity bytes of the file starting from the page holding logical
+            bool attach(int fd, std::uint64_t logical, std::size_t capacity,
+                        std::uint64_t allocated) noexcept {
+                detach();
+                fd_ = fd;
+                allocated_ = allocated;
+                offset_ = logical / page_size() * page_size();
+                size_ = std::size_t(logical - offset_);
+                capacity = std::size_t(round_up(capacity < size_ + 1 ? size_ + 1 : capacity,
+                                                page_size()));
+                if(!preallocate(offset_ + capacity))
+                    return false;
+                auto* mapped = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                      fd_, ::off_t(offset_));
+                if(mapped == MAP_FAILED) {
+                    error_ = {errno, std::system_category()};
+                    return false;
+                }
+                base_ = static_cast<char*>(mapped);
+                capacity_ = capacity;
+                return true;
+            }
+
+
+            // Moves the window forward so that it starts at the logical end
+            bool slide(std::size_t capacity) noexcept {
+                return attach(fd_, logical(), capacity, allocated_);
+            }
+
+
+            void detach() noexcept {
+                if(base_ != nullptr)
+                    ::munmap(base_, capacity_);
+                base_ = nullptr;
+                capacity_ = 0;
+            }
+
+
+            // Writes dirty pages of the window back to the file
+            bool sync() noexcept {
+                if(base_ == nullptr || size_ == 0)
+                    return true;
+                if(::msync(base_, size_, MS_SYNC) == -1) {
+                    error_ = {errno, std::system_category()};
+                    return false;
+                }
+                return true;
+            }
+
+
+            // Grows the window in place of reallocation, existing text stays put
+            void reserve(size_type n) noexcept {
+                if(n <= capacity_ || base_ == nullptr)
+                    return;
+                n = std::size_t(round_up(n, page_size()));
+                if(!preallocate(offset_ + n))
+                    return;
+                auto* remapped = ::mremap(base_, capacity_, n, MREMAP_MAYMOVE);
+                if(remapped == MAP_FAILED) {
+                    error_ = {errno, std::system_category()};
+                    return;
+                }
+                base_ = static_cast<char*>(remapped);
+                capacity_ = n;
+            }
+
+
+            void resize(size_type n) noexcept { size_ = n; }
+
+
+        private:
+
+            bool preallocate(std::uint64_t end) noexcept {
+                if(end <= allocated_)
+                    return true;
+                auto const grown = ::fallocate(fd_, 0, ::off_t(allocated_),
+                                               ::off_t(end - allocated_)) == 0
+                                   || ((errno == EOPNOTSUPP || errno == ENOSYS)
+                                       && ::ftruncate(fd_, ::off_t(end)) == 0);
+                if(!grown) {
+                    error_ = {errno, std::system_category()};
+                    return false;
+                }
+                allocated_ = end;
+                return true;
+            }
+        }; // window
+
+
+        // Size of the file when it was opened for writing, removed on close,
+        // so its presence tells that the file was not closed
+        constexpr char const* open_marker = "user.ufmt.mapped";
+
+
+        inline void mark_open(int fd, std::uint64_t size) noexcept {
+            ::fsetxattr(fd, open_marker, &size, sizeof(size), 0);
+        }
+
+
+        // Preallocated space left by a crash is the run of zero bytes at the
+        // end of file. Printed lines end with a newline, so only zeros past
+        // the last line go. Nothing below the size recorded on open is
+        // trimmed, and a file that was closed is left alone. Without
+        // extended attributes every trailing zero is taken for preallocation
+        inline bool recover_size(int fd, std::uint64_t& size, std::error_code& ec) noexcept {
+            struct ::stat info;
+            if(::fstat(fd, &info) == -1) {
+                ec = {errno, std::system_category()};
+                return false;
+            }
+            size = std::uint64_t(info.st_size);
+            std::uint64_t start = 0;
+            auto const marked = ::fgetxattr(fd, open_marker, &start, sizeof(start));
+            if(marked == -1 && errno == ENODATA)
+                return true;
+            if(marked != sizeof(start) || start > size)
+                start = 0;
+            char chunk[4096];
+            while(size != start) {
+                auto const left = size - start;
+                auto const n = left < sizeof(chunk) ? std::size_t(left) : sizeof(chunk);
+                auto const was_read = ::pread(fd, chunk, n, ::off_t(size - n));
+                if(was_read == -1) {
+                    if(errno == EINTR)
+                        continue;
+                    ec = {errno, std::system_category()};
+                    return false;
+                }
+                if(std::size_t(was_read) != n) {
+                    ec = std::make_error_code(std::errc::io_error);
+                    return false;
+                }
+                for(auto i = n; i != 0; --i)
+                    if(chunk[i - 1] != '\0') {
+                        size -= n - i;
+                        return true;
+                    }
+                size -= n;
+            }
+            return true;
+        }
+
+    } // namespace detail::mapped
+
+
+    // Formats lines straight into a shared mapping of preallocated file space,
+    // the file is truncated to the written size on close
+    class mapped_text_file {
+        basic_text<detail::mapped::window> text_;
+        int handle_{-1};
+        mapped_options options_;
+        std::uint64_t written_back_{0};
+        std::error_code error_;
+
+        mapped_text_file(int handle, std::uint64_t size, mapped_options const& options) noexcept
+            : handle_{handle}, options_{options}, written_back_{size} {
+            if(!text_.string().attach(handle_, size, options_.window_size, size))
+                error_ = text_.string().error();
+        }
+
+        static std::optional<mapped_text_file> open(std::string const& path, int flags,
+                                                    bool recover, mapped_options const& options,
+                                                    std::error_code& ec) {
+            auto const opened = ::open(path.data(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            std::uint64_t size = 0;
+            if(recover && (!detail::mapped::recover_size(opened, size, ec)
+                           || ::ftruncate(opened, ::off_t(size)) == -1)) {
+                if(!ec)
+                    ec = {errno, std::system_category()};
+                ::close(opened);
+                return std::nullopt;
+            }
+            detail::mapped::mark_open(opened, size);
+            mapped_text_file file{opened, size, options};
+            if(file.error_) {
+                ec = file.error_;
+                return std::nullopt;
+            }
+            return file;
+        }
+
+    public:
+
+        static std::optional<mapped_text_file> create_always(std::string const& path,
+                                                             std::error_code& ec,
+                                                             mapped_options const& options = {}) {
+            return open(path, O_CREAT | O_TRUNC | O_RDWR, false, options, ec);
+        }
+
+
+        // Trims preallocated zeros left by a writer that did not close the file
+        static std::optional<mapped_text_file> open_always_to_append(std::string const& path,
+                                                                     std::error_code& ec,
+                                                                     mapped_options const& options = {}) {
+            return open(path, O_CREAT | O_RDWR, true, options, ec);
+        }
+
+
+        ~mapped_text_file() noexcept { close(); }
+        mapped_text_file(mapped_text_file const&) = delete;
+        mapped_text_file& operator = (mapped_text_file const&) = delete;
+
+
+        mapped_text_file(mapped_text_file&& other) noexcept
+            : text_{std::move(other.text_)},
+              handle_{std::exchange(other.handle_, -1)},
+              options_{other.options_},
+              written_back_{other.written_back_},
+              error_{other.error_} { }
+
+
+        mapped_text_file& operator = (mapped_text_file&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            text_ = std::move(other.text_);
+            handle_ = std::exchange(other.handle_, -1);
+            options_ = other.options_;
+            written_back_ = other.written_back_;
+            error_ = other.error_;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return handle_ != -1; }
+
+        std::uint64_t size() const noexcept { return text_.string().logical(); }
+
+        std::error_code const& error() const noexcept {
+            return error_ ? error_ : text_.string().error();
+        }
+
+
+        void close() noexcept {
+            if(handle_ == -1)
+                return;
+            auto& window = text_.string();
+            auto const size = window.logical();
+            window.detach();
+            if(::ftruncate(handle_, ::off_t(size)) == -1 && !error_)
+                error_ = {errno, std::system_category()};
+            else
+                ::fremovexattr(handle_, detail::mapped::open_marker);
+            ::close(handle_);
+            handle_ = -1;
+        }
+
+
+        // Waits until everything printed so far is on the storage
+        bool flush() noexcept {
+            if(!text_.string().sync())
+                return false;
+            if(::fdatasync(handle_) == -1) {
+                error_ = {errno, std::system_category()};
+                return false;
+            }
+            return true;
+        }
+
+
+        template<typename... Args>
+        void print(Args&&... args) {
+            auto& window = text_.string();
+            if(window.size() >= window.capacity() / 2)
+                window.slide(options_.window_size);
+            text_.format(std::forward<Args>(args)..., '\n');
+            if(options_.writeback_bytes != 0
+               && window.logical() - written_back_ >= options_.writeback_bytes) {
+                ::sync_file_range(handle_, ::off_t(written_back_),
+                                  ::off_t(window.logical() - written_back_),
+                                  SYNC_FILE_RANGE_WRITE);
+                written_back_ = window.logical();
+            }
+        }
+    }; // mapped_text_file
+
+} // namespace ufmt
@@ -0,0 +1,399 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    namespace detail::memfd {
+
+        constexpr std::size_t page_size = 4096;
+
+        constexpr auto seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+
+
+        // Storage for basic_text in a shared mapping of a memfd,
+        // growing it extends the memfd with ftruncate and remaps
+        class region {
+            int fd_{-1};
+            char* data_{nullptr};
+            std::size_t size_{0};
+            std::size_t capacity_{0};
+            std::error_code error_;
+
+        public:
+
+            using value_type = char;
+            using size_type = std::size_t;
+
+            region() noexcept = default;
+            region(region const&) = delete;
+            region& operator = (region const&) = delete;
+
+            region(region&& other) noexcept
+                : fd_{std::exchange(other.fd_, -1)},
+                  data_{std::exchange(other.data_, nullptr)},
+                  size_{std::exchange(other.size_, 0)},
+                  capacity_{std::exchange(other.capacity_, 0)},
+                  error_{other.error_} { }
+
+            region& operator = (region&& other) noexcept {
+                if(this == &other)
+                    return *this;
+                unmap();
+                fd_ = std::exchange(other.fd_, -1);
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+                capacity_ = std::exchange(other.capacity_, 0);
+                error_ = other.error_;
+                return *this;
+            }
+
+            ~region() { unmap(); }
+
+
+            char* data() noexcept { return data_; }
+            char const* data() const noexcept { return data_; }
+            size_type size() const noexcept { return size_; }
+            size_type capacity() const noexcept { return capacity_; }
+            bool empty() const noexcept { return size_ == 0; }
+            void clear() noexcept { size_ = 0; }
+            char& operator[](size_type i) noexcept { return data_[i]; }
+            char operator[](size_type i) const noexcept { return data_[i]; }
+
+            std::error_code const& error() const noexcept { return error_; }
+
+
+            void attach(int fd) noexcept { fd_ = fd; }
+
+
+            // Leaves the capacity unchanged on failure, basic_text then truncates
+            void reserve(size_type n) noexcept {
+                if(n <= capacity_ || fd_ == -1)
+                    return;
+                n = (n + page_size - 1) / page_size * page_size;
+                if(::ftruncate(fd_, ::off_t(n)) == -1) {
+                    error_ = {errno, std::system_category()};
+                    return;
+                }
+                auto* mapped = data_ == nullptr
+                    ? ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0)
+                    : ::mremap(data_, capacity_, n, MREMAP_MAYMOVE);
+                if(mapped == MAP_FAILED) {
+                    error_ = {errno, std::system_category()};
+                    return;
+                }
+                data_ = static_cast<char*>(mapped);
+                capacity_ = n;
+            }
+
+
+            void resize(size_type n) noexcept {
+                reserve(n);
+                if(n <= capacity_)
+                    size_ = n;
+            }
+
+
+            // Maps the memfd again after a failed seal, keeping the content.
+            // If that fails too the text is lost and error() stays set
+            bool remap(int fd, size_type capacity) noexcept {
+                fd_ = fd;
+                reserve(capacity);
+                if(data_ != nullptr)
+                    return true;
+                fd_ = -1;
+                size_ = 0;
+                return false;
+            }
+
+
+            // The writable mapping has to go before the memfd can be sealed
+            void unmap() noexcept {
+                if(data_ != nullptr)
+                    ::munmap(data_, capacity_);
+                data_ = nullptr;
+                capacity_ = 0;
+                fd_ = -1;
+            }
+        }; // region
+
+    } // namespace detail::memfd
+
+
+    // Read-only mapping of a sealed memfd received from another process
+    class memfd_view {
+        int fd_{-1};
+        char const* data_{nullptr};
+        std::size_t size_{0};
+
+        memfd_view(int fd, char const* data, std::size_t size) noexcept
+            : fd_{fd}, data_{data}, size_{size} { }
+
+    public:
+
+        // Takes the descriptor sent by memfd_sink::send, rejects unsealed ones
+        static std::optional<memfd_view> receive(int socket, std::error_code& ec) {
+            constexpr std::size_t most = 4;
+            std::uint64_t size = 0;
+            ::iovec payload{&size, sizeof(size)};
+            alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int) * most)];
+            ::msghdr message{};
+            message.msg_iov = &payload;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            ssize_t received;
+            do {
+                received = ::recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+            } while(received == -1 && errno == EINTR);
+            if(received == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+
+            // every descriptor that arrived is ours to close, wanted or not
+            int fds[most];
+            std::size_t count = 0;
+            for(auto* header = CMSG_FIRSTHDR(&message); header != nullptr;
+                header = CMSG_NXTHDR(&message, header)) {
+                if(header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+                    continue;
+                auto const n = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for(std::size_t i = 0; i != n && count != most; ++i)
+                    std::memcpy(&fds[count++], CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+            }
+            if(received != sizeof(size) || (message.msg_flags & MSG_CTRUNC) != 0 || count != 1) {
+                for(std::size_t i = 0; i != count; ++i)
+                    ::close(fds[i]);
+                ec = std::make_error_code(std::errc::bad_message);
+                return std::nullopt;
+            }
+            auto const fd = fds[0];
+
+            // F_GET_SEALS fails with -1, all bits set, on anything but a memfd
+            auto const sealed = ::fcntl(fd, F_GET_SEALS);
+            struct ::stat info{};
+            if(sealed == -1 || (sealed & detail::memfd::seals) != detail::memfd::seals
+               || ::fstat(fd, &info) == -1 || std::uint64_t(info.st_size) != size) {
+                ec = std::make_error_code(std::errc::bad_message);
+                ::close(fd);
+                return std::nullopt;
+            }
+            if(size == 0)
+                return memfd_view{fd, nullptr, 0};
+            auto* mapped = ::mmap(nullptr, std::size_t(size), PROT_READ, MAP_SHARED, fd, 0);
+            if(mapped == MAP_FAILED) {
+                ec = {errno, std::system_category()};
+                ::close(fd);
+                return std::nullopt;
+            }
+            return memfd_view{fd, static_cast<char const*>(mapped), std::size_t(size)};
+        }
+
+
+        ~memfd_view() noexcept { close(); }
+        memfd_view(memfd_view const&) = delete;
+        memfd_view& operator = (memfd_view const&) = delete;
+
+        memfd_view(memfd_view&& other) noexcept
+            : fd_{std::exchange(other.fd_, -1)},
+              data_{std::exchange(other.data_, nullptr)},
+              size_{std::exchange(other.size_, 0)} { }
+
+        memfd_view& operator = (memfd_view&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return fd_ != -1; }
+
+        int fd() const noexcept { return fd_; }
+        std::string_view view() const noexcept { return {data_, size_}; }
+
+
+        void close() noexcept {
+            if(fd_ == -1)
+                return;
+            if(data_ != nullptr)
+                ::munmap(const_cast<char*>(data_), size_);
+            ::close(fd_);
+            fd_ = -1;
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }; // memfd_view
+
+
+    // Formats a report straight into a memfd mapping; once sealed the memfd
+    // is immutable and can be passed to another process, which maps it
+    class memfd_sink {
+        using region_text = basic_text<detail::memfd::region>;
+
+        int fd_{-1};
+        region_text text_;
+        bool sealed_{false};
+
+        explicit memfd_sink(int fd) noexcept: fd_{fd} {
+            text_.string().attach(fd);
+        }
+
+    public:
+
+        static std::optional<memfd_sink> create(std::string const& name, std::error_code& ec,
+                                                std::size_t capacity = 65536) {
+            auto const fd = ::memfd_create(name.data(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+            if(fd == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            memfd_sink sink{fd};
+            sink.text_.reserve(capacity);
+            if(sink.text_.string().error()) {
+                ec = sink.text_.string().error();
+                return std::nullopt;
+            }
+            return sink;
+        }
+
+
+        ~memfd_sink() noexcept { close(); }
+        memfd_sink(memfd_sink const&) = delete;
+        memfd_sink& operator = (memfd_sink const&) = delete;
+
+        memfd_sink(memfd_sink&& other) noexcept
+            : fd_{std::exchange(other.fd_, -1)},
+              text_{std::move(other.text_)},
+              sealed_{other.sealed_} { }
+
+        memfd_sink& operator = (memfd_sink&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+            text_ = std::move(other.text_);
+            sealed_ = other.sealed_;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return fd_ != -1; }
+
+        int fd() const noexcept { return fd_; }
+        bool sealed() const noexcept { return sealed_; }
+        std::size_t size() const noexcept { return text_.size(); }
+
+        // Report so far, empty once sealed or after a failed seal lost the mapping
+        std::string_view view() const noexcept {
+            return sealed_ || text_.data() == nullptr ? std::string_view{} : text_.view();
+        }
+
+
+        void close() noexcept {
+            if(fd_ == -1)
+                return;
+            text_.string().unmap();
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+
+        bool write(std::string_view sv, std::error_code& ec) {
+            if(sealed_) {
+                ec = std::make_error_code(std::errc::operation_not_permitted);
+                return false;
+            }
+            auto const size = text_.size();
+            text_.append(sv.data(), sv.size());
+            if(text_.size() == size + sv.size())
+                return true;
+            ec = text_.string().error();
+            return false;
+        }
+
+
+        template<typename... Args>
+        bool print(Args&&... args) {
+            if(sealed_)
+                return false;
+            text_.format(std::forward<Args>(args)..., '\n');
+            return !text_.string().error();
+        }
+
+
+        // Trims the memfd to the report and forbids any further change.
+        // On failure the report is mapped again and stays writable
+        bool seal(std::error_code& ec) noexcept {
+            if(sealed_)
+                return true;
+            auto const size = text_.size();
+            auto const capacity = text_.capacity();
+            text_.string().unmap();
+            if(::ftruncate(fd_, ::off_t(size)) == -1
+               || ::fcntl(fd_, F_ADD_SEALS, detail::memfd::seals) == -1) {
+                ec = {errno, std::system_category()};
+                text_.string().remap(fd_, capacity);
+                return false;
+            }
+            sealed_ = true;
+            return true;
+        }
+
+
+        // Seals and passes the descriptor with its size over a unix socket
+        bool send(int socket, std::error_code& ec) noexcept {
+            std::uint64_t size = text_.size();
+            if(!seal(ec))
+                return false;
+            ::iovec payload{&size, sizeof(size)};
+            alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            ::msghdr message{};
+            message.msg_iov = &payload;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            auto* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(header), &fd_, sizeof(fd_));
+            for(;;) {
+                if(::sendmsg(socket, &message, MSG_NOSIGNAL) != -1)
+                    return true;
+                if(errno == EINTR)
+                    continue;
+                ec = {errno, std::system_category()};
+                return false;
+            }
+        }
+    }; // memfd_sink
+
+} // namespace ufmt
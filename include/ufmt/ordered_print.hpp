@@ -0,0 +1,400 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "io.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct ordered_options {
+        std::size_t capacity{1024};   // slots of every thread queue
+        int fd{1};
+        std::chrono::microseconds idle_sleep{200};
+    }; // ordered_options
+
+
+    namespace detail::ordered {
+
+        constexpr std::size_t slot_size = 64;
+
+
+        struct alignas(slot_size) slot {
+            std::uint64_t timestamp;
+            std::uint32_t size;
+            std::uint32_t count;
+            char data[slot_size - 16];
+        }; // slot
+
+        static_assert(sizeof(slot) == slot_size);
+
+        constexpr auto padding = std::numeric_limits<std::uint32_t>::max();
+
+
+        inline std::uint64_t now() noexcept {
+            return std::uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+        }
+
+
+        // Wait-free single producer, single consumer ring of cache line slots,
+        // a record longer than one slot occupies several consecutive ones
+        class queue {
+            std::unique_ptr<slot[]> slots_;
+            std::size_t capacity_;
+
+            alignas(slot_size) std::atomic<std::size_t> tail_{0};
+            std::size_t cached_head_{0};
+            std::atomic<std::uint64_t> dropped_{0};
+
+            alignas(slot_size) std::atomic<std::size_t> head_{0};
+            std::size_t cached_tail_{0};
+
+            alignas(slot_size) std::atomic<std::uint64_t> pending_{0};
+            std::atomic<bool> abandoned_{false};
+            std::atomic<bool> closed_{false};
+
+        public:
+
+            explicit queue(std::size_t capacity)
+                : slots_{new slot[capacity]}, capacity_{capacity} { }
+
+
+            std::uint64_t dropped() const noexcept {
+                return dropped_.load(std::memory_order_relaxed);
+            }
+
+
+            bool push(char const* data, std::size_t size) noexcept {
+                // every record not visible yet is stamped after pending
+                pending_.store(now(), std::memory_order_seq_cst);
+                auto const timestamp = now();
+
+                auto const count = (offsetof(slot, data) + size + slot_size - 1) / slot_size;
+                auto const tail = tail_.load(std::memory_order_relaxed);
+                auto const index = tail % capacity_;
+                auto const skipped = index + count > capacity_ ? capacity_ - index : 0;
+                auto const needed = skipped + count;
+                if(count > capacity_ || !has_room(tail, needed)) {
+                    dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+                    pending_.store(0, std::memory_order_release);
+                    return false;
+                }
+
+                if(skipped != 0) {
+                    slots_[index].count = std::uint32_t(skipped);
+                    slots_[index].size = padding;
+                }
+                auto& first = slots_[(tail + skipped) % capacity_];
+                first.timestamp = timestamp;
+                first.size = std::uint32_t(size);
+                first.count = std::uint32_t(count);
+                std::memcpy(first.data, data, size);
+
+                tail_.store(tail + needed, std::memory_order_release);
+                pending_.store(0, std::memory_order_release);
+                return true;
+            }
+
+
+            // Lower bound of timestamps this queue can still publish
+            std::uint64_t pending() const noexcept {
+                return pending_.load(std::memory_order_seq_cst);
+            }
+
+
+            // Consumer side: published record at the position, skips padding
+            slot const* peek(std::size_t& position) noexcept {
+                for(;;) {
+                    if(position == cached_tail_) {
+                        cached_tail_ = tail_.load(std::memory_order_acquire);
+                        if(position == cached_tail_)
+                            return nullptr;
+                    }
+                    auto const& s = slots_[position % capacity_];
+                    if(s.size != padding)
+                        return &s;
+                    position += s.count;
+                }
+            }
+
+
+            std::size_t head() const noexcept {
+                return head_.load(std::memory_order_relaxed);
+            }
+
+
+            void release(std::size_t position) noexcept {
+                head_.store(position, std::memory_order_release);
+            }
+
+
+            bool drained_until(std::size_t position) const noexcept {
+                return head_.load(std::memory_order_acquire) >= position;
+            }
+
+
+            std::size_t published() const noexcept {
+                return tail_.load(std::memory_order_acquire);
+            }
+
+
+            // The producing thread has exited, nothing is pushed any more
+            void abandon() noexcept { abandoned_.store(true, std::memory_order_release); }
+            bool abandoned() const noexcept { return abandoned_.load(std::memory_order_acquire); }
+
+            // The printer is gone, the producing thread may forget the queue
+            void close() noexcept { closed_.store(true, std::memory_order_relaxed); }
+            bool closed() const noexcept { return closed_.load(std::memory_order_relaxed); }
+
+        private:
+
+            bool has_room(std::size_t tail, std::size_t needed) noexcept {
+                if(tail + needed - cached_head_ <= capacity_)
+                    return true;
+                cached_head_ = head_.load(std::memory_order_acquire);
+                return tail + needed - cached_head_ <= capacity_;
+            }
+        }; // queue
+
+
+        struct local {
+            std::uint64_t owner;
+            std::shared_ptr<queue> q;
+        }; // local
+
+
+        // Queues of the thread by printer, abandoned when the thread exits
+        struct locals {
+            std::vector<local> entries;
+
+            ~locals() {
+                for(auto& e: entries)
+                    e.q->abandon();
+            }
+        }; // locals
+
+        inline thread_local locals current;
+        inline thread_local text buffer;
+        inline std::atomic<std::uint64_t> instances{0};
+
+    } // namespace detail::ordered
+
+
+    // Every producing thread owns a wait-free queue, the background thread
+    // merges records by their timestamps so output stays globally ordered
+    class ordered_printer {
+        std::uint64_t id_;
+        std::size_t capacity_;
+        int fd_;
+        std::chrono::microseconds idle_sleep_;
+
+        std::mutex sync_;
+        std::vector<std::shared_ptr<detail::ordered::queue>> queues_;
+        std::uint64_t retired_dropped_{0};
+        std::atomic<bool> stopping_{false};
+        std::atomic<bool> stopped_{false};
+        std::error_code error_;
+        std::thread thread_;
+
+    public:
+
+        explicit ordered_printer(ordered_options const& options = ordered_options{})
+            : id_{detail::ordered::instances.fetch_add(1) + 1},
+              capacity_{options.capacity},
+              fd_{options.fd},
+              idle_sleep_{options.idle_sleep} {
+            thread_ = std::thread{[this] { merge(); }};
+        }
+
+        ordered_printer(ordered_printer const&) = delete;
+        ordered_printer& operator = (ordered_printer const&) = delete;
+
+        ~ordered_printer() {
+            stop();
+            std::unique_lock g{sync_};
+            for(auto const& q: queues_)
+                q->close();
+        }
+
+
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        // Queues of threads that printed and have not exited or not been merged
+        std::size_t queues() {
+            std::unique_lock g{sync_};
+            return queues_.size();
+        }
+
+
+        std::uint64_t dropped() {
+            std::unique_lock g{sync_};
+            auto total = retired_dropped_;
+            for(auto const& q: queues_)
+                total += q->dropped();
+            return total;
+        }
+
+
+        // Never blocks, returns false when the thread queue is full
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto& buffer = detail::ordered::buffer;
+            buffer.clear();
+            buffer.format(std::forward<Args>(args)..., '\n');
+            if(stopped_.load(std::memory_order_relaxed)) {
+                std::error_code ec;
+                return detail::io::write_all(fd_, buffer.data(), buffer.size(), ec);
+            }
+            return local_queue().push(buffer.data(), buffer.size());
+        }
+
+
+        // Waits until every line printed before the call is written
+        void flush() {
+            std::vector<std::pair<std::shared_ptr<detail::ordered::queue>, std::size_t>> targets;
+            {
+                std::unique_lock g{sync_};
+                for(auto const& q: queues_)
+                    targets.emplace_back(q, q->published());
+            }
+            for(auto const& [q, position]: targets)
+                while(!q->drained_until(position) && !stopped_.load())
+                    std::this_thread::sleep_for(idle_sleep_);
+        }
+
+
+        // Writes all queued lines and joins the background thread,
+        // should not race with print()
+        void stop() noexcept {
+            if(stopping_.exchange(true))
+                return;
+            thread_.join();
+            stopped_.store(true, std::memory_order_relaxed);
+        }
+
+
+    private:
+
+        detail::ordered::queue& local_queue() {
+            auto& entries = detail::ordered::current.entries;
+            for(auto const& e: entries)
+                if(e.owner == id_)
+                    return *e.q;
+            std::erase_if(entries, [](auto const& e) { return e.q->closed(); });
+            auto created = std::make_shared<detail::ordered::queue>(capacity_);
+            {
+                std::unique_lock g{sync_};
+                queues_.push_back(created);
+            }
+            entries.push_back({id_, created});
+            return *created;
+        }
+
+
+        // Queue of an exited thread with everything merged
+        void retire(detail::ordered::queue* q) {
+            std::unique_lock g{sync_};
+            auto const found = std::find_if(queues_.begin(), queues_.end(),
+                                            [q](auto const& p) { return p.get() == q; });
+            retired_dropped_ += q->dropped();
+            queues_.erase(found);
+        }
+
+
+        void merge() noexcept {
+            using detail::ordered::queue;
+            using detail::ordered::slot;
+
+            std::vector<queue*> queues;
+            std::vector<std::size_t> positions;
+            std::vector<slot const*> fronts;
+            text output;
+
+            for(;;) {
+                auto const stopping = stopping_.load(std::memory_order_seq_cst);
+                {
+                    std::unique_lock g{sync_};
+                    queues.clear();
+                    for(auto const& q: queues_)
+                        queues.push_back(q.get());
+                }
+
+                // nothing stamped before the watermark can show up later
+                auto watermark = detail::ordered::now();
+                for(auto* q: queues) {
+                    auto const pending = q->pending();
+                    if(pending != 0)
+                        watermark = std::min(watermark, pending);
+                }
+                if(stopping)
+                    watermark = std::numeric_limits<std::uint64_t>::max();
+
+                positions.resize(queues.size());
+                fronts.resize(queues.size());
+                for(std::size_t i = 0; i != queues.size(); ++i) {
+                    positions[i] = queues[i]->head();
+                    fronts[i] = queues[i]->peek(positions[i]);
+                }
+
+                std::size_t merged = 0;
+                for(;;) {
+                    std::size_t oldest = queues.size();
+                    for(std::size_t i = 0; i != queues.size(); ++i) {
+                        if(fronts[i] == nullptr || fronts[i]->timestamp >= watermark)
+                            continue;
+                        if(oldest == queues.size()
+                           || fronts[i]->timestamp < fronts[oldest]->timestamp)
+                            oldest = i;
+                    }
+                    if(oldest == queues.size())
+                        break;
+                    auto const* s = fronts[oldest];
+                    output.append(s->data, s->size);
+                    positions[oldest] += s->count;
+                    fronts[oldest] = queues[oldest]->peek(positions[oldest]);
+                    ++merged;
+                }
+
+                if(!output.empty()) {
+                    std::error_code ec;
+                    if(!detail::io::write_all(fd_, output.data(), output.size(), ec))
+                        error_ = ec;
+                    output.clear();
+                }
+                for(std::size_t i = 0; i != queues.size(); ++i) {
+                    queues[i]->release(positions[i]);
+                    if(queues[i]->abandoned() && queues[i]->published() == positions[i])
+                        retire(queues[i]);
+                }
+
+                if(merged != 0)
+                    continue;
+                if(stopping)
+                    return;
+                std::this_thread::sleep_for(idle_sleep_);
+            }
+        }
+    }; // ordered_printer
+
+} // namespace ufmt
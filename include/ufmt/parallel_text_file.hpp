@@ -0,0 +1,131 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io.hpp"
+#include "text.hpp"
+#include "watermark.hpp"
+
+
+namespace ufmt {
+
+
+    namespace detail::parallel {
+
+        inline thread_local text buffer;
+
+    } // namespace detail::parallel
+
+
+    // Thread-safe file where every record reserves its range with fetch_add
+    // and is written with pwrite independently of the others
+    class parallel_text_file {
+        int handle_{-1};
+        std::unique_ptr<detail::watermark> offsets_;
+
+        parallel_text_file(int handle, std::uint64_t start)
+            : handle_{handle}, offsets_{std::make_unique<detail::watermark>(start)} { }
+
+        static std::optional<parallel_text_file> open(std::string const& path, int flags,
+                                                      bool append, std::error_code& ec) {
+            auto const opened = ::open(path.data(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            struct ::stat info{};
+            if(append && ::fstat(opened, &info) == -1) {
+                ec = {errno, std::system_category()};
+                ::close(opened);
+                return std::nullopt;
+            }
+            return parallel_text_file{opened, std::uint64_t(info.st_size)};
+        }
+
+    public:
+
+        static std::optional<parallel_text_file> create_always(std::string const& path,
+                                                               std::error_code& ec) {
+            return open(path, O_CREAT | O_TRUNC | O_WRONLY, false, ec);
+        }
+
+
+        static std::optional<parallel_text_file> open_always_to_append(std::string const& path,
+                                                                       std::error_code& ec) {
+            return open(path, O_CREAT | O_WRONLY, true, ec);
+        }
+
+
+        ~parallel_text_file() noexcept { close(); }
+        parallel_text_file(parallel_text_file const&) = delete;
+        parallel_text_file& operator = (parallel_text_file const&) = delete;
+
+
+        parallel_text_file(parallel_text_file&& other) noexcept
+            : handle_{std::exchange(other.handle_, -1)}, offsets_{std::move(other.offsets_)} { }
+
+
+        parallel_text_file& operator = (parallel_text_file&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            handle_ = std::exchange(other.handle_, -1);
+            offsets_ = std::move(other.offsets_);
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return handle_ != -1; }
+
+
+        // Should not race with writers
+        void close() noexcept {
+            if(handle_ == -1)
+                return;
+            ::close(handle_);
+            handle_ = -1;
+        }
+
+
+        // File length reserved by all records so far
+        std::uint64_t reserved() const noexcept { return offsets_->reserved(); }
+
+        // File length with no holes left by records still being written
+        std::uint64_t committed() { return offsets_->committed(); }
+
+
+        bool write(std::string_view sv, std::error_code& ec) {
+            auto const offset = offsets_->reserve(sv.size());
+            auto const written = detail::io::pwrite_all(handle_, sv.data(), sv.size(), offset, ec);
+            offsets_->commit();
+            return written;
+        }
+
+
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto& line = detail::parallel::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+            std::error_code ec;
+            return write(line.view(), ec);
+        }
+    }; // parallel_text_file
+
+} // namespace ufmt
@@ -0,0 +1,298 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "io.hpp"
+#include "print.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct pipe_options {
+        int fd{1};
+        std::size_t buffer_size{65536};   // rounded up to whole pages
+        unsigned buffers{4};
+        bool splice{true};                // false always copies with write(2)
+    }; // pipe_options
+
+
+    namespace detail::splice {
+
+        constexpr std::size_t page_size = 4096;
+
+
+        // Character storage in its own anonymous mapping: pages handed to
+        // a pipe stay valid even after the storage is released
+        class pages {
+            char* data_{nullptr};
+            std::size_t size_{0};
+            std::size_t capacity_{0};
+
+        public:
+
+            using value_type = char;
+            using size_type = std::size_t;
+
+            pages() noexcept = default;
+            ~pages() { release(); }
+            pages(pages const&) = delete;
+            pages& operator = (pages const&) = delete;
+
+            pages(pages&& other) noexcept
+                : data_{std::exchange(other.data_, nullptr)},
+                  size_{std::exchange(other.size_, 0)},
+                  capacity_{std::exchange(other.capacity_, 0)} { }
+
+            pages& operator = (pages&& other) noexcept {
+                if(this == &other)
+                    return *this;
+                release();
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+                capacity_ = std::exchange(other.capacity_, 0);
+                return *this;
+            }
+
+
+            char* data() noexcept { return data_; }
+            char const* data() const noexcept { return data_; }
+            size_type size() const noexcept { return size_; }
+            size_type capacity() const noexcept { return capacity_; }
+            bool empty() const noexcept { return size_ == 0; }
+            void clear() noexcept { size_ = 0; }
+            char& operator[](size_type i) noexcept { return data_[i]; }
+            char operator[](size_type i) const noexcept { return data_[i]; }
+
+
+            void reserve(size_type n) {
+                if(n <= capacity_)
+                    return;
+                n = (n + page_size - 1) / page_size * page_size;
+                auto* mapped = ::mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(mapped == MAP_FAILED)
+                    throw std::bad_alloc{};
+                if(size_ != 0)
+                    std::memcpy(mapped, data_, size_);
+                auto const size = size_;
+                release();
+                data_ = static_cast<char*>(mapped);
+                size_ = size;
+                capacity_ = n;
+            }
+
+
+            void resize(size_type n) {
+                reserve(n);
+                size_ = n;
+            }
+
+
+        private:
+
+            void release() noexcept {
+                if(data_ == nullptr)
+                    return;
+                ::munmap(data_, capacity_);
+                data_ = nullptr;
+                size_ = 0;
+                capacity_ = 0;
+            }
+        }; // pages
+
+
+        inline bool is_pipe(int fd) noexcept {
+            struct ::stat info{};
+            return ::fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+        }
+
+    } // namespace detail::splice
+
+
+    // Formats lines into page aligned buffers and moves whole pages into
+    // a pipe with vmsplice(SPLICE_F_GIFT) instead of copying them. A buffer
+    // is reused only after the reader has consumed it, so the reader has to
+    // read(2) the pipe: pages it splice(2)s onward may still be referenced
+    // after they left the pipe. Writes with write(2) when the descriptor is
+    // not a pipe or vmsplice is not available
+    class pipe_printer {
+        using page_text = basic_text<detail::splice::pages>;
+
+        detail::printer::spinlock sync_;
+        int fd_;
+        std::size_t buffer_size_;
+        bool splice_;
+        std::vector<page_text> buffers_;
+        std::vector<std::uint64_t> ends_;    // sent_ when the buffer went to the pipe
+        std::size_t current_{0};
+        std::uint64_t sent_{0};
+        std::error_code error_;
+
+    public:
+
+        explicit pipe_printer(pipe_options const& options = pipe_options{})
+            : fd_{options.fd},
+              buffer_size_{(options.buffer_size + detail::splice::page_size - 1)
+                           / detail::splice::page_size * detail::splice::page_size},
+              splice_{options.splice && detail::splice::is_pipe(options.fd)},
+              buffers_(!splice_ ? 1 : options.buffers < 2 ? 2 : options.buffers),
+              ends_(buffers_.size(), 0) {
+            if(buffer_size_ == 0)
+                buffer_size_ = detail::splice::page_size;
+            for(auto& b: buffers_)
+                b.reserve(buffer_size_ + detail::splice::page_size);
+        }
+
+        pipe_printer(pipe_printer const&) = delete;
+        pipe_printer& operator = (pipe_printer const&) = delete;
+
+        ~pipe_printer() { flush(); }
+
+
+        // False when lines are copied with write(2)
+        bool spliced() {
+            std::unique_lock g{sync_};
+            return splice_;
+        }
+
+
+        std::error_code error() {
+            std::unique_lock g{sync_};
+            return error_;
+        }
+
+
+        // Formats under the lock, straight into the buffer given to the pipe
+        template<typename... Args>
+        void print(Args&&... args) {
+            std::unique_lock g{sync_};
+            auto& buffer = buffers_[current_];
+            buffer.format(std::forward<Args>(args)..., '\n');
+            if(buffer.size() >= buffer_size_)
+                submit(false);
+        }
+
+
+        void flush() {
+            std::unique_lock g{sync_};
+            if(!buffers_[current_].empty())
+                submit(true);
+        }
+
+
+    private:
+
+        // Sends whole pages and carries the partial one to the next buffer,
+        // the partial page is written too when everything is due
+        void submit(bool everything) {
+            auto& filled = buffers_[current_];
+            std::error_code ec;
+            auto const whole = splice_ ? filled.size() / detail::splice::page_size
+                                         * detail::splice::page_size
+                                       : filled.size();
+            auto sent = send(filled.data(), whole, ec);
+            auto tail = filled.size() - whole;
+            if(sent && everything && tail != 0) {
+                sent = detail::io::write_all(fd_, filled.data() + whole, tail, ec);
+                if(sent)
+                    sent_ += tail;
+                tail = 0;
+            }
+            if(!sent)
+                error_ = ec;
+            if(!splice_ && tail == 0) {
+                filled.clear();
+                return;
+            }
+
+            ends_[current_] = sent_;
+            auto const next = (current_ + 1) % buffers_.size();
+            wait_consumed(next);
+            buffers_[next].clear();
+            buffers_[next].append(filled.data() + whole, tail);
+            current_ = next;
+        }
+
+
+        bool send(char const* data, std::size_t size, std::error_code& ec) {
+            ::iovec remaining{const_cast<char*>(data), size};
+            while(splice_ && remaining.iov_len != 0) {
+                auto const moved = ::vmsplice(fd_, &remaining, 1, SPLICE_F_GIFT);
+                if(moved == -1) {
+                    if(errno == EINTR)
+                        continue;
+                    if(errno == EAGAIN) {
+                        if(!detail::io::wait_writable(fd_, ec))
+                            return false;
+                        continue;
+                    }
+                    if(errno != EINVAL && errno != ENOSYS && errno != EPERM) {
+                        ec = {errno, std::system_category()};
+                        return false;
+                    }
+                    splice_ = false;
+                    break;
+                }
+                remaining.iov_base = static_cast<char*>(remaining.iov_base) + moved;
+                remaining.iov_len -= std::size_t(moved);
+                sent_ += std::uint64_t(moved);
+            }
+            if(remaining.iov_len == 0)
+                return true;
+            if(!detail::io::write_all(fd_, static_cast<char const*>(remaining.iov_base),
+                                      remaining.iov_len, ec))
+                return false;
+            sent_ += remaining.iov_len;
+            return true;
+        }
+
+
+        // Pages of the buffer are still referenced by the pipe until read.
+        // FIONREAD counts bytes of other writers too, so sent_ - unread is only
+        // a lower bound of what the reader took from us. Sleeps between checks,
+        // nothing drains once the reader is gone, the pipe reports POLLERR then
+        void wait_consumed(std::size_t index) {
+            auto pause = std::chrono::microseconds{50};
+            for(;;) {
+                int unread = 0;
+                if(error_ || ::ioctl(fd_, FIONREAD, &unread) == -1)
+                    return;
+                if(std::uint64_t(unread) <= sent_ && sent_ - std::uint64_t(unread) >= ends_[index])
+                    return;
+                ::pollfd state{fd_, 0, 0};
+                if(::poll(&state, 1, 0) == 1 && (state.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+                    return;
+                std::this_thread::sleep_for(pause);
+                pause = std::min(pause * 2, std::chrono::microseconds{10000});
+            }
+        }
+    }; // pipe_printer
+
+} // namespace ufmt
@@ -6,7 +6,12 @@
 
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <system_error>
 #include <thread>
 
 
@@ -24,8 +29,12 @@
 
 #else
 
+#    include <limits.h>
+#    include <sys/stat.h>
 #    include <unistd.h>
 
+#    include "io.hpp"
+
 #endif   // WIN32
 
 #include "text.hpp"
@@ -33,31 +42,63 @@
 
 namespace ufmt {
 
+
+    // Collected only when UFMT_LOCK_STATISTICS is defined. The macro changes
+    // the layout of the lock, so it has to be the same in every translation
+    // unit of a program
+    struct lock_statistics {
+        std::uint64_t acquisitions{0};
+        std::uint64_t contended{0};
+        std::chrono::nanoseconds wait_time{0};
+    }; // lock_statistics
+
+
     namespace detail::printer {
 
+        inline void cpu_relax() noexcept {
+#if defined(_MSC_VER)
+            YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            asm volatile("yield");
+#endif
+        }
+
+
+        // Spins with pause and exponential backoff, then yields,
+        // then parks on the futex (WaitOnAddress on Windows)
         class spinlock {
         public:
 
+            static constexpr unsigned max_backoff = 64;
+            static constexpr unsigned yields = 4;
+
+
             spinlock() noexcept = default;
             spinlock(spinlock const&) noexcept = delete;
             spinlock& operator = (spinlock const&) noexcept = delete;
 
             bool try_lock() noexcept {
-                if(flag_.load(std::memory_order_relaxed))
+                if(!try_acquire())
                     return false;
-
-                return !flag_.exchange(true, std::memory_order_acquire);
+                count_acquisition();
+                return true;
             }
 
 
             void unlock() noexcept {
-                flag_.store(false, std::memory_order_release);
+                if(state_.exchange(unlocked, std::memory_order_release) == parked)
+                    state_.notify_one();
             }
 
 
             void lock() noexcept {
-                while(!try_lock())
-                    std::this_thread::yield();
+                if(try_acquire()) {
+                    count_acquisition();
+                    return;
+                }
+                lock_contended();
             }
 
 
@@ -76,34 +117,215 @@ namespace ufmt {
             }
 
 
+            lock_statistics statistics() const noexcept {
+#if defined(UFMT_LOCK_STATISTICS)
+                return {acquisitions_.load(std::memory_order_relaxed),
+                        contended_.load(std::memory_order_relaxed),
+                        std::chrono::nanoseconds{wait_ns_.load(std::memory_order_relaxed)}};
+#else
+                return {};
+#endif
+            }
+
+
         private:
 
-            std::atomic_bool flag_{false};
+            static constexpr std::uint32_t unlocked = 0;
+            static constexpr std::uint32_t locked = 1;
+            static constexpr std::uint32_t parked = 2;
+
+            std::atomic<std::uint32_t> state_{unlocked};
+
+#if defined(UFMT_LOCK_STATISTICS)
+            // updated only by the lock owner, so plain stores are enough
+            std::atomic<std::uint64_t> acquisitions_{0};
+            std::atomic<std::uint64_t> contended_{0};
+            std::atomic<std::uint64_t> wait_ns_{0};
+#endif
+
+            bool try_acquire() noexcept {
+                auto expected = unlocked;
+                return state_.load(std::memory_order_relaxed) == unlocked
+                    && state_.compare_exchange_strong(expected, locked,
+                                                      std::memory_order_acquire,
+                                                      std::memory_order_relaxed);
+            }
+
+
+            void lock_contended() noexcept {
+#if defined(UFMT_LOCK_STATISTICS)
+                auto const started = std::chrono::steady_clock::now();
+#endif
+                if(!spin()) {
+                    while(state_.exchange(parked, std::memory_order_acquire) != unlocked)
+                        state_.wait(parked, std::memory_order_relaxed);
+                }
+#if defined(UFMT_LOCK_STATISTICS)
+                auto const waited = std::chrono::steady_clock::now() - started;
+                count_acquisition();
+                contended_.store(contended_.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+                wait_ns_.store(wait_ns_.load(std::memory_order_relaxed)
+                                   + std::uint64_t(std::chrono::nanoseconds{waited}.count()),
+                               std::memory_order_relaxed);
+#endif
+            }
+
+
+            bool spin() noexcept {
+                // the owner can't release the lock while we spin on the only CPU
+                static bool const single_cpu = std::thread::hardware_concurrency() == 1;
+                for(unsigned backoff = 1; !single_cpu && backoff <= max_backoff; backoff <<= 1) {
+                    for(unsigned i = 0; i != backoff; ++i)
+                        cpu_relax();
+                    if(try_acquire())
+                        return true;
+                }
+                for(unsigned i = 0; i != yields; ++i) {
+                    std::this_thread::yield();
+                    if(try_acquire())
+                        return true;
+                }
+                return false;
+            }
+
+
+            void count_acquisition() noexcept {
+#if defined(UFMT_LOCK_STATISTICS)
+                acquisitions_.store(acquisitions_.load(std::memory_order_relaxed) + 1,
+                                    std::memory_order_relaxed);
+#endif
+            }
 
         }; // spinlock
 
 
+#if defined(_WIN32)
+        using handle_type = DWORD;
+        constexpr auto stdout_handle = DWORD(-11);
+        constexpr auto stderr_handle = DWORD(-12);
+        constexpr auto atomic_write_size = std::size_t(4096);
+#else
+        using handle_type = int;
+        constexpr auto stdout_handle = 1;
+        constexpr auto stderr_handle = 2;
+        constexpr auto atomic_write_size = std::size_t(PIPE_BUF);
+#endif
+
+
         inline spinlock sync;
-        inline text buffer;
+        inline std::shared_mutex pipe_sync;   // short lines to a pipe share it, long ones own it
+        inline thread_local text buffer;
+
+
+        constexpr int unknown_target = 0;
+        constexpr int fifo_target = 1;
+        constexpr int other_target = 2;
+
+        // What stdout and stderr are, checked on first use
+        inline std::atomic<int> targets[2] = {unknown_target, unknown_target};
+
+
+        // Only pipes append up to atomic_write_size bytes in one piece,
+        // ttys and regular files may split a write and interleave it
+        inline bool fifo(handle_type handle) noexcept {
+#if defined(_WIN32)
+            (void)handle;
+            return false;
+#else
+            auto& target = targets[handle == stdout_handle ? 0 : 1];
+            auto kind = target.load(std::memory_order_relaxed);
+            if(kind == unknown_target) {
+                struct ::stat info{};
+                kind = ::fstat(handle, &info) == 0 && S_ISFIFO(info.st_mode)
+                     ? fifo_target : other_target;
+                target.store(kind, std::memory_order_relaxed);
+            }
+            return kind == fifo_target;
+#endif
+        }
+
+
+        inline void write_unlocked(handle_type handle, text const& line) noexcept {
+#if defined(_WIN32)
+            WriteFile(GetStdHandle(handle), line.data(), DWORD(line.size()), nullptr, nullptr);
+#else
+            ++io::system_calls;
+            ::write(handle, line.data(), line.size());
+#endif
+        }
+
+
+        // Lines are serialized to keep them unbroken. A pipe takes short lines
+        // in one piece, so they only have to wait for a long line that the
+        // pipe may split while it is full
+        inline void write(handle_type handle, text const& line) noexcept {
+            if(!fifo(handle)) {
+                std::unique_lock g {sync};
+                write_unlocked(handle, line);
+                return;
+            }
+            if(line.size() <= atomic_write_size) {
+                std::shared_lock g {pipe_sync};
+                write_unlocked(handle, line);
+                return;
+            }
+            std::unique_lock g {sync};
+            std::unique_lock p {pipe_sync};
+            write_unlocked(handle, line);
+        }
 
     }   // namespace detail::printer
 
 
+    // Call after stdout or stderr was replaced (dup2, freopen),
+    // print checks again whether the new target is a pipe
+    inline void output_redirected() noexcept {
+        for(auto& target: detail::printer::targets)
+            target.store(detail::printer::unknown_target, std::memory_order_relaxed);
+    }
+
+
+    // Waiting for the lock that serializes lines
+    inline lock_statistics print_lock_statistics() noexcept {
+        return detail::printer::sync.statistics();
+    }
+
+
     template<typename... Args>
     void print(Args&&... args) {
-        std::unique_lock g {detail::printer::sync};
-        detail::printer::buffer.clear();
-        detail::printer::buffer.format(std::forward<Args>(args)..., '\n');
+        auto& buffer = detail::printer::buffer;
+        buffer.clear();
+        buffer.format(std::forward<Args>(args)..., '\n');
+        detail::printer::write(detail::printer::stdout_handle, buffer);
+    }
+
 
+    // Writes finished texts as they are with one writev,
+    // batches are not interleaved with other output
+    inline void print_all(std::span<text const* const> texts) noexcept {
 #if defined(_WIN32)
-        WriteFile(GetStdHandle(DWORD(-11)),
-            detail::printer::buffer.data(),
-            DWORD(detail::printer::buffer.size()),
-            nullptr,
-            nullptr
-        );
+        std::unique_lock g {detail::printer::sync};
+        for(auto const* t: texts)
+            detail::printer::write_unlocked(detail::printer::stdout_handle, *t);
 #else
-        write(1, detail::printer::buffer.data(), detail::printer::buffer.size());
+        std::size_t total = 0;
+        for(auto const* t: texts)
+            total += t->size();
+        std::error_code ec;
+        if(!detail::printer::fifo(detail::printer::stdout_handle)) {
+            std::unique_lock g {detail::printer::sync};
+            detail::io::write_gathered(detail::printer::stdout_handle, texts, ec);
+            return;
+        }
+        if(total <= detail::printer::atomic_write_size && texts.size() <= detail::io::max_buffers) {
+            std::shared_lock g {detail::printer::pipe_sync};
+            detail::io::write_gathered(detail::printer::stdout_handle, texts, ec);
+            return;
+        }
+        std::unique_lock g {detail::printer::sync};
+        std::unique_lock p {detail::printer::pipe_sync};
+        detail::io::write_gathered(detail::printer::stdout_handle, texts, ec);
 #endif
     }
 
@@ -117,22 +339,10 @@ namespace ufmt {
 
     template<typename... Args>
     void error(Args&&... args) {
-        std::unique_lock g {detail::printer::sync};
-        detail::printer::buffer.clear();
-        detail::printer::buffer.format(std::forward<Args>(args)..., '\n');
-
-#if defined(_WIN32)
-
-        WriteFile(GetStdHandle(DWORD(-12)),
-            detail::printer::buffer.data(),
-            DWORD(detail::printer::buffer.size()),
-            nullptr,
-            nullptr
-        );
-
-#else
-        write(2, detail::printer::buffer.data(), detail::printer::buffer.size());
-#endif
+        auto& buffer = detail::printer::buffer;
+        buffer.clear();
+        buffer.format(std::forward<Args>(args)..., '\n');
+        detail::printer::write(detail::printer::stderr_handle, buffer);
     }
 
 
@@ -0,0 +1,182 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "io.hpp"
+#include "print.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct printer_options {
+        int fd{1};
+        std::size_t capacity{65536};                 // flush when buffered this much
+        std::chrono::milliseconds max_delay{100};    // flush lines older than this
+        bool background_flush{false};                // flush stale lines without new prints
+    }; // printer_options
+
+
+    // Collects lines into a large buffer and writes them in one go.
+    // A flush swaps the buffer under the spinlock and writes it outside,
+    // flushes are kept in order by their own mutex
+    class printer {
+        using clock = std::chrono::steady_clock;
+
+        detail::printer::spinlock sync_;
+        text buffer_;
+        printer_options options_;
+        clock::time_point oldest_;
+        std::uint64_t lines_{0};
+        std::uint64_t flushes_{0};
+        std::error_code error_;
+
+        std::mutex write_sync_;
+        text writing_;
+
+        std::mutex timer_sync_;
+        std::condition_variable timer_wakeup_;
+        bool timer_stopping_{false};
+        std::thread timer_;
+
+    public:
+
+        explicit printer(printer_options const& options = printer_options{}) {
+            configure(options);
+        }
+
+        printer(printer const&) = delete;
+        printer& operator = (printer const&) = delete;
+
+        ~printer() {
+            stop_timer();
+            flush();
+        }
+
+
+        void configure(printer_options const& options) {
+            stop_timer();
+            flush();
+            {
+                std::unique_lock w{write_sync_};
+                std::unique_lock g{sync_};
+                options_ = options;
+                buffer_.reserve(options_.capacity);
+                writing_.reserve(options_.capacity);
+            }
+            if(options.background_flush)
+                timer_ = std::thread{[this] { run_timer(); }};
+        }
+
+
+        template<typename... Args>
+        void print(Args&&... args) {
+            auto& line = detail::printer::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+
+            bool due;
+            {
+                std::unique_lock g{sync_};
+                auto const now = clock::now();
+                if(buffer_.empty())
+                    oldest_ = now;
+                buffer_.append(line.data(), line.size());
+                ++lines_;
+                due = buffer_.size() >= options_.capacity || now - oldest_ >= options_.max_delay;
+            }
+            if(due)
+                flush();
+        }
+
+
+        void flush() { flush_if(false); }
+
+
+        std::uint64_t lines() {
+            std::unique_lock g{sync_};
+            return lines_;
+        }
+
+
+        // Number of buffers handed to write(2), each may take several calls
+        std::uint64_t flushes() {
+            std::unique_lock g{sync_};
+            return flushes_;
+        }
+
+
+        std::error_code error() {
+            std::unique_lock g{sync_};
+            return error_;
+        }
+
+
+    private:
+
+        // Printing goes on into the other buffer while this one is written
+        void flush_if(bool stale_only) {
+            std::unique_lock w{write_sync_};
+            {
+                std::unique_lock g{sync_};
+                if(buffer_.empty()
+                   || (stale_only && clock::now() - oldest_ < options_.max_delay))
+                    return;
+                std::swap(buffer_, writing_);
+                ++flushes_;
+            }
+            std::error_code ec;
+            auto const written = detail::io::write_all(options_.fd, writing_.data(),
+                                                       writing_.size(), ec);
+            writing_.clear();
+            if(written)
+                return;
+            std::unique_lock g{sync_};
+            error_ = ec;
+        }
+
+
+        void run_timer() {
+            std::unique_lock g{timer_sync_};
+            while(!timer_stopping_) {
+                timer_wakeup_.wait_for(g, options_.max_delay);
+                flush_if(true);
+            }
+        }
+
+
+        void stop_timer() {
+            if(!timer_.joinable())
+                return;
+            {
+                std::unique_lock g{timer_sync_};
+                timer_stopping_ = true;
+            }
+            timer_wakeup_.notify_one();
+            timer_.join();
+            timer_stopping_ = false;
+        }
+    }; // printer
+
+
+    // Buffered stdout, flushed at exit
+    inline printer& global_printer() {
+        static printer instance;
+        return instance;
+    }
+
+} // namespace ufmt
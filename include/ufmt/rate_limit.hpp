@@ -0,0 +1,174 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "print.hpp"
+
+
+// Per call site variants, arguments are evaluated only for printed lines
+#define UFMT_PRINT_EVERY_N(n, ...)                                                \
+    do {                                                                          \
+        static ::ufmt::every_n_limiter ufmt_limiter{n};                           \
+        if(ufmt_limiter.admit())                                                  \
+            ::ufmt::detail::rate::print(ufmt_limiter.take_suppressed(), __VA_ARGS__); \
+    } while(false)
+
+#define UFMT_PRINT_AT_MOST_PER(period, ...)                                       \
+    do {                                                                          \
+        static ::ufmt::rate_limiter ufmt_limiter{period};                         \
+        if(ufmt_limiter.admit())                                                  \
+            ::ufmt::detail::rate::print(ufmt_limiter.take_suppressed(), __VA_ARGS__); \
+    } while(false)
+
+#define UFMT_PRINT_SAMPLED(probability, ...)                                      \
+    do {                                                                          \
+        static ::ufmt::sampler ufmt_limiter{probability};                         \
+        if(ufmt_limiter.admit())                                                  \
+            ::ufmt::detail::rate::print(ufmt_limiter.take_suppressed(), __VA_ARGS__); \
+    } while(false)
+
+
+namespace ufmt {
+
+
+    namespace detail::rate {
+
+        class suppressed_counter {
+            std::atomic<std::uint64_t> suppressed_{0};
+
+        public:
+
+            void suppress() noexcept {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Lines dropped since the previous printed one
+            std::uint64_t take_suppressed() noexcept {
+                if(suppressed_.load(std::memory_order_relaxed) == 0)
+                    return 0;
+                return suppressed_.exchange(0, std::memory_order_relaxed);
+            }
+        }; // suppressed_counter
+
+
+        template<typename... Args>
+        void print(std::uint64_t suppressed, Args&&... args) {
+            if(suppressed == 0)
+                ufmt::print(std::forward<Args>(args)...);
+            else
+                ufmt::print(std::forward<Args>(args)..., " (", suppressed, " suppressed)");
+        }
+
+
+        inline std::uint64_t random() noexcept {
+            thread_local std::uint64_t state = 0x9e3779b97f4a7c15ull
+                ^ std::uint64_t(reinterpret_cast<std::uintptr_t>(&state));
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+    } // namespace detail::rate
+
+
+    // Admits the first of every n lines
+    class every_n_limiter: public detail::rate::suppressed_counter {
+        std::atomic<std::uint64_t> count_{0};
+        std::uint64_t n_;
+
+    public:
+
+        explicit every_n_limiter(std::uint64_t n) noexcept: n_{n == 0 ? 1 : n} { }
+
+        bool admit() noexcept {
+            if(count_.fetch_add(1, std::memory_order_relaxed) % n_ == 0)
+                return true;
+            suppress();
+            return false;
+        }
+    }; // every_n_limiter
+
+
+    // Token bucket of burst lines refilled once per period (GCRA)
+    class rate_limiter: public detail::rate::suppressed_counter {
+        using clock = std::chrono::steady_clock;
+
+        std::atomic<clock::rep> theoretical_arrival_{0};
+        clock::rep period_;
+        clock::rep tolerance_;
+
+    public:
+
+        template<class Rep, class Period>
+        explicit rate_limiter(std::chrono::duration<Rep, Period> period,
+                              unsigned burst = 1) noexcept
+            : period_{std::chrono::duration_cast<clock::duration>(period).count()},
+              tolerance_{period_ * clock::rep(burst == 0 ? 0 : burst - 1)} { }
+
+        bool admit() noexcept {
+            auto const now = clock::now().time_since_epoch().count();
+            auto tat = theoretical_arrival_.load(std::memory_order_relaxed);
+            for(;;) {
+                if(tat - now > tolerance_) {
+                    suppress();
+                    return false;
+                }
+                auto const next = (tat > now ? tat : now) + period_;
+                if(theoretical_arrival_.compare_exchange_weak(tat, next,
+                                                              std::memory_order_relaxed))
+                    return true;
+            }
+        }
+    }; // rate_limiter
+
+
+    // Admits lines with the given probability
+    class sampler: public detail::rate::suppressed_counter {
+        std::uint64_t threshold_;
+
+    public:
+
+        explicit sampler(double probability) noexcept
+            : threshold_{probability >= 1. ? ~std::uint64_t(0)
+                         : probability <= 0. ? 0
+                         : std::uint64_t(probability * 18446744073709551616.)} { }
+
+        bool admit() noexcept {
+            if(detail::rate::random() < threshold_)
+                return true;
+            suppress();
+            return false;
+        }
+    }; // sampler
+
+
+    template<typename... Args>
+    void print_every_n(every_n_limiter& limiter, Args&&... args) {
+        if(limiter.admit())
+            detail::rate::print(limiter.take_suppressed(), std::forward<Args>(args)...);
+    }
+
+
+    template<typename... Args>
+    void print_at_most_per(rate_limiter& limiter, Args&&... args) {
+        if(limiter.admit())
+            detail::rate::print(limiter.take_suppressed(), std::forward<Args>(args)...);
+    }
+
+
+    template<typename... Args>
+    void print_sampled(sampler& limiter, Args&&... args) {
+        if(limiter.admit())
+            detail::rate::print(limiter.take_suppressed(), std::forward<Args>(args)...);
+    }
+
+} // namespace ufmt
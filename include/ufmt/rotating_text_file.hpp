@@ -0,0 +1,336 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io.hpp"
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    struct rotation_options {
+        std::uint64_t max_size{std::uint64_t(64) << 20};   // rotate once a file holds this much
+        std::chrono::milliseconds max_age{0};               // rotate older files, 0 to disable
+        unsigned keep{8};                                   // files to retain with the current one, 0 keeps all
+    }; // rotation_options
+
+
+    namespace detail::rotate {
+
+        struct file {
+            int fd;
+            std::uint32_t index;
+            std::atomic<std::uint64_t> size{0};
+            file* retired{nullptr};         // link in the list of swapped out files
+        }; // file
+
+
+        // Files are named path.000001, path.000002 and so on
+        inline std::string numbered(std::string const& path, std::uint32_t index) {
+            return text::of(path, '.', ufmt::fixed(index, 6));
+        }
+
+
+        inline std::unique_ptr<file> open(std::string const& path, std::uint32_t index,
+                                          std::error_code& ec) {
+            auto const name = numbered(path, index);
+            auto const opened = ::open(name.data(), O_CREAT | O_TRUNC | O_WRONLY,
+                                       S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return nullptr;
+            }
+            auto f = std::make_unique<file>();
+            f->fd = opened;
+            f->index = index;
+            return f;
+        }
+
+
+        // Indices of existing path.NNNNNN files in ascending order
+        inline std::vector<std::uint32_t> existing(std::string const& path) {
+            namespace fs = std::filesystem;
+            std::vector<std::uint32_t> indices;
+            auto const base = fs::path{path};
+            auto directory = base.parent_path();
+            if(directory.empty())
+                directory = ".";
+            auto const prefix = base.filename().string() + '.';
+            std::error_code ec;
+            for(auto const& entry: fs::directory_iterator{directory, ec}) {
+                auto const name = entry.path().filename().string();
+                if(name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+                    continue;
+                std::uint32_t index = 0;
+                auto const* first = name.data() + prefix.size();
+                auto const* last = name.data() + name.size();
+                auto const [end, parsed] = std::from_chars(first, last, index);
+                if(parsed == std::errc{} && end == last)
+                    indices.push_back(index);
+            }
+            std::sort(indices.begin(), indices.end());
+            return indices;
+        }
+
+
+        inline thread_local text buffer;
+
+
+        // Opens the next file ahead, swaps on age, closes retired files
+        // and removes files beyond retention. Writers only touch atomics:
+        // a swapped out file is pushed to a lock-free list and freed by the
+        // thread once both reader counters were seen drained after the swap
+        struct state {
+            std::string path;
+            rotation_options options;
+            std::atomic<file*> current{nullptr};
+            std::atomic<file*> next{nullptr};
+            std::atomic<file*> retired{nullptr};
+            std::atomic<std::uint64_t> rotations{0};
+            alignas(64) std::atomic<std::uint64_t> epoch{0};
+            std::atomic<unsigned> readers[2]{};
+
+            alignas(64) std::mutex sync;
+            std::condition_variable wakeup;
+            bool stopping{false};
+            std::error_code error;
+            std::thread thread;
+
+            // used by the thread only
+            std::vector<std::uint32_t> kept;
+            file* prepared{nullptr};
+            std::chrono::steady_clock::time_point opened;
+
+
+            ~state() {
+                {
+                    std::unique_lock g{sync};
+                    stopping = true;
+                }
+                wakeup.notify_one();
+                if(thread.joinable())
+                    thread.join();
+                close(retired.exchange(nullptr));
+                if(auto* last = current.load()) {
+                    ::close(last->fd);
+                    delete last;
+                }
+                if(auto* unused = next.load()) {
+                    ::close(unused->fd);
+                    ::unlink(numbered(path, unused->index).data());
+                    delete unused;
+                }
+            }
+
+
+            // A file loaded from current stays valid until leave()
+            unsigned enter() noexcept {
+                auto const parity = unsigned(epoch.load() & 1);
+                readers[parity].fetch_add(1);
+                return parity;
+            }
+
+
+            void leave(unsigned parity) noexcept { readers[parity].fetch_sub(1); }
+
+
+            // Swaps in the pre-opened file, never blocks. The caller
+            // keeps expected entered until it returns
+            bool swap(file* expected) noexcept {
+                auto* ready = next.exchange(nullptr);
+                if(ready == nullptr)
+                    return false;
+                if(!current.compare_exchange_strong(expected, ready)) {
+                    next.store(ready);
+                    return false;
+                }
+                expected->retired = retired.load(std::memory_order_relaxed);
+                while(!retired.compare_exchange_weak(expected->retired, expected))
+                    ;
+                rotations.fetch_add(1, std::memory_order_relaxed);
+                wakeup.notify_one();
+                return true;
+            }
+
+
+            // Every writer that could have loaded a retired file has left
+            // once each counter was zero after the epoch moved past it
+            void synchronize() noexcept {
+                for(auto i = 0; i != 2; ++i) {
+                    auto const parity = epoch.fetch_add(1) & 1;
+                    while(readers[parity].load() != 0)
+                        std::this_thread::yield();
+                }
+            }
+
+
+            static void close(file* list) noexcept {
+                while(list != nullptr) {
+                    auto* f = list;
+                    list = f->retired;
+                    ::close(f->fd);
+                    delete f;
+                }
+            }
+
+
+            void run() {
+                using namespace std::chrono;
+                opened = steady_clock::now();
+                std::unique_lock g{sync};
+                while(!stopping) {
+                    g.unlock();
+                    auto* active = current.load();
+                    if(prepared == active) {
+                        kept.push_back(active->index);
+                        opened = steady_clock::now();
+                        prepared = nullptr;
+                    }
+
+                    std::error_code ec;
+                    if(prepared == nullptr) {
+                        if(auto ready = open(path, active->index + 1, ec)) {
+                            prepared = ready.release();
+                            next.store(prepared);
+                        }
+                    }
+
+                    while(options.keep != 0 && kept.size() > options.keep) {
+                        ::unlink(numbered(path, kept.front()).data());
+                        kept.erase(kept.begin());
+                    }
+
+                    if(auto* list = retired.exchange(nullptr)) {
+                        synchronize();
+                        close(list);
+                    }
+
+                    auto rotated = false;
+                    if(options.max_age.count() != 0 && steady_clock::now() - opened >= options.max_age) {
+                        if(active->size.load() == 0)
+                            opened = steady_clock::now();
+                        else
+                            rotated = swap(active);
+                    }
+
+                    g.lock();
+                    if(ec)
+                        error = ec;
+                    if(rotated || stopping)
+                        continue;
+                    steady_clock::duration timeout = milliseconds{100};
+                    if(options.max_age.count() != 0)
+                        timeout = std::clamp<steady_clock::duration>(
+                            opened + options.max_age - steady_clock::now(), milliseconds{1}, timeout);
+                    wakeup.wait_for(g, timeout);
+                }
+            }
+        }; // state
+
+    } // namespace detail::rotate
+
+
+    // Thread-safe file rotated by size and age, the next file is opened
+    // in background so writers only swap a pointer
+    class rotating_text_file {
+        std::unique_ptr<detail::rotate::state> state_;
+
+        explicit rotating_text_file(std::unique_ptr<detail::rotate::state> state) noexcept
+            : state_{std::move(state)} { }
+
+    public:
+
+        // Continues numbering after existing path.NNNNNN files
+        static std::optional<rotating_text_file> open(std::string const& path,
+                                                      std::error_code& ec,
+                                                      rotation_options const& options = {}) {
+            auto state = std::make_unique<detail::rotate::state>();
+            state->path = path;
+            state->options = options;
+            state->kept = detail::rotate::existing(path);
+            auto const index = state->kept.empty() ? 1 : state->kept.back() + 1;
+            auto first = detail::rotate::open(path, index, ec);
+            if(!first)
+                return std::nullopt;
+            state->current.store(first.release());
+            state->kept.push_back(index);
+            auto* raw = state.get();
+            state->thread = std::thread{[raw] { raw->run(); }};
+            return rotating_text_file{std::move(state)};
+        }
+
+
+        explicit operator bool () const noexcept { return state_ != nullptr; }
+
+        std::uint64_t rotations() const noexcept {
+            return state_->rotations.load(std::memory_order_relaxed);
+        }
+
+        std::string current_path() const {
+            auto const parity = state_->enter();
+            auto const index = state_->current.load()->index;
+            state_->leave(parity);
+            return detail::rotate::numbered(state_->path, index);
+        }
+
+
+        // Last failure to pre-open the next file, rotation waits until it succeeds
+        std::error_code error() const {
+            std::unique_lock g{state_->sync};
+            return state_->error;
+        }
+
+
+        void close() noexcept { state_.reset(); }
+
+
+        bool write(std::string_view sv, std::error_code& ec) noexcept {
+            auto& s = *state_;
+            auto const parity = s.enter();
+            auto* f = s.current.load();
+            auto const written = detail::io::write_all(f->fd, sv.data(), sv.size(), ec);
+            auto const size = f->size.fetch_add(sv.size(), std::memory_order_relaxed) + sv.size();
+            if(size >= s.options.max_size)
+                s.swap(f);
+            s.leave(parity);
+            return written;
+        }
+
+
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto& line = detail::rotate::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+            std::error_code ec;
+            return write(line.view(), ec);
+        }
+    }; // rotating_text_file
+
+} // namespace ufmt
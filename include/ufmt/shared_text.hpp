@@ -0,0 +1,125 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "sink.hpp"
+#include "text.hpp"
+#include "watermark.hpp"
+
+
+namespace ufmt {
+
+
+    namespace detail::shared {
+
+        inline thread_local text buffer;
+
+    } // namespace detail::shared
+
+
+    // Fixed buffer many threads format into at once: a line is measured
+    // by formatting it into a thread-local scratch text, its range is
+    // reserved with fetch_add and copied in. A separate size pass would
+    // cost as much as formatting, so the line is formatted once and copied.
+    // flush() hands out everything committed so far
+    class shared_text {
+        std::size_t capacity_;
+        std::unique_ptr<char[]> data_;
+        detail::watermark cursor_;
+        alignas(64) std::atomic<std::uint64_t> limit_;     // start of the first range that did not fit
+        std::atomic<std::uint64_t> dropped_{0};
+        std::uint64_t flushed_{0};
+
+    public:
+
+        explicit shared_text(std::size_t capacity)
+            : capacity_{capacity},
+              data_{std::make_unique_for_overwrite<char[]>(capacity)},
+              limit_{capacity} { }
+
+        shared_text(shared_text const&) = delete;
+        shared_text& operator = (shared_text const&) = delete;
+
+
+        std::size_t capacity() const noexcept { return capacity_; }
+
+        // Lines rejected because the buffer was full
+        std::uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+        // Length with no holes left by lines still being copied
+        std::size_t committed() {
+            return std::size_t(std::min(cursor_.committed(),
+                                        limit_.load(std::memory_order_acquire)));
+        }
+
+
+        // Committed bytes, valid until clear()
+        std::string_view view() { return {data_.get(), committed()}; }
+
+
+        // Starts over, should not race with writers
+        void clear() {
+            cursor_.reset();
+            limit_.store(capacity_, std::memory_order_relaxed);
+            dropped_.store(0, std::memory_order_relaxed);
+            flushed_ = 0;
+        }
+
+
+        bool write(std::string_view sv, std::error_code&) {
+            auto const begin = cursor_.reserve(sv.size());
+            auto const end = begin + sv.size();
+            if(end <= capacity_) {
+                std::memcpy(data_.get() + begin, sv.data(), sv.size());
+                cursor_.commit();
+                return true;
+            }
+            // ranges from here on are not flushed
+            auto limit = limit_.load(std::memory_order_relaxed);
+            while(begin < limit && !limit_.compare_exchange_weak(limit, begin,
+                                                                 std::memory_order_release,
+                                                                 std::memory_order_relaxed))
+                ;
+            cursor_.commit();
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto& line = detail::shared::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+            std::error_code ec;
+            return write(line.view(), ec);
+        }
+
+
+        // Writes committed bytes not flushed before, called by one consumer at a time
+        template<ufmt::sink S>
+        bool flush(S& sink, std::error_code& ec) {
+            auto const end = committed();
+            if(end == flushed_)
+                return true;
+            if(!sink.write(std::string_view{data_.get() + flushed_, end - flushed_}, ec))
+                return false;
+            flushed_ = end;
+            return true;
+        }
+    }; // shared_text
+
+} // namespace ufmt
@@ -0,0 +1,210 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <concepts>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "io.hpp"
+#include "text.hpp"
+#include "text_file.hpp"
+
+
+namespace ufmt {
+
+
+    // Destination of finished bytes, text_file, buffered_file and the sinks below
+    template<class S>
+    concept sink = requires(S& s, std::string_view sv, std::error_code& ec) {
+        { s.write(sv, ec) } -> std::convertible_to<bool>;
+    };
+
+
+    // Descriptor owned by someone else, e.g. stdout
+    class fd_sink {
+        int fd_;
+
+    public:
+
+        explicit fd_sink(int fd) noexcept: fd_{fd} { }
+
+        int fd() const noexcept { return fd_; }
+
+        bool write(std::string_view sv, std::error_code& ec) noexcept {
+            return detail::io::write_all(fd_, sv.data(), sv.size(), ec);
+        }
+    }; // fd_sink
+
+
+    // Owned file, text_file already writes the way a sink does
+    using file_sink = text_file<>;
+
+
+    class memory_sink {
+        text text_;
+
+    public:
+
+        std::string_view view() const noexcept { return text_.view(); }
+        void clear() noexcept { text_.clear(); }
+
+        bool write(std::string_view sv, std::error_code&) {
+            text_.append(sv.data(), sv.size());
+            return true;
+        }
+    }; // memory_sink
+
+
+    struct null_sink {
+        bool write(std::string_view, std::error_code&) noexcept { return true; }
+    }; // null_sink
+
+
+    // Connected stream socket, a gone peer is reported as EPIPE without SIGPIPE
+    class socket_sink {
+        int fd_{-1};
+
+    public:
+
+        static std::optional<socket_sink> connect(std::string const& path, std::error_code& ec) {
+            ::sockaddr_un address{};
+            if(path.size() >= sizeof(address.sun_path)) {
+                ec = std::make_error_code(std::errc::filename_too_long);
+                return std::nullopt;
+            }
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.data(), path.size());
+            auto const opened = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            if(::connect(opened, reinterpret_cast<::sockaddr const*>(&address),
+                         sizeof(address)) == -1) {
+                ec = {errno, std::system_category()};
+                ::close(opened);
+                return std::nullopt;
+            }
+            return socket_sink{opened};
+        }
+
+
+        // Takes ownership of a connected socket
+        explicit socket_sink(int fd) noexcept: fd_{fd} { }
+
+        ~socket_sink() noexcept { close(); }
+        socket_sink(socket_sink const&) = delete;
+        socket_sink& operator = (socket_sink const&) = delete;
+
+        socket_sink(socket_sink&& other) noexcept: fd_{std::exchange(other.fd_, -1)} { }
+
+        socket_sink& operator = (socket_sink&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return fd_ != -1; }
+
+
+        void close() noexcept {
+            if(fd_ == -1)
+                return;
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+
+        bool write(std::string_view sv, std::error_code& ec) noexcept {
+            auto const* data = sv.data();
+            auto size = sv.size();
+            while(size != 0) {
+                auto const sent = ::send(fd_, data, size, MSG_NOSIGNAL);
+                if(sent == -1) {
+                    if(errno == EINTR)
+                        continue;
+                    if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                        if(!detail::io::wait_writable(fd_, ec))
+                            return false;
+                        continue;
+                    }
+                    ec = {errno, std::system_category()};
+                    return false;
+                }
+                data += sent;
+                size -= std::size_t(sent);
+            }
+            return true;
+        }
+    }; // socket_sink
+
+
+    namespace detail::sink {
+        inline thread_local text buffer;
+    } // namespace detail::sink
+
+
+    // Formats a line once and writes the same bytes to every sink in order,
+    // sinks may be references to objects owned elsewhere
+    template<ufmt::sink... Sinks> class logger {
+        std::tuple<Sinks...> sinks_;
+        std::error_code error_;
+
+    public:
+
+        explicit logger(Sinks... sinks): sinks_{std::forward<Sinks>(sinks)...} { }
+
+
+        template<std::size_t I>
+        auto& get() noexcept { return std::get<I>(sinks_); }
+
+        // First failure of print()
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        // Every sink gets the bytes in order, even if a previous one failed
+        bool write(std::string_view sv, std::error_code& ec) {
+            auto ok = true;
+            std::apply([&](auto&... s) {
+                ((ok &= bool(s.write(sv, ec))), ...);
+            }, sinks_);
+            return ok;
+        }
+
+
+        template<typename... Args>
+        bool print(Args&&... args) {
+            auto& line = detail::sink::buffer;
+            line.clear();
+            line.format(std::forward<Args>(args)..., '\n');
+            std::error_code ec;
+            if(write(line.view(), ec))
+                return true;
+            if(!error_)
+                error_ = ec;
+            return false;
+        }
+    }; // logger
+
+
+    template<class... Sinks> logger(Sinks...) -> logger<Sinks...>;
+
+} // namespace ufmt
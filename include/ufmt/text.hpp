@@ -51,6 +51,7 @@ namespace ufmt {
         basic_text& operator=(basic_text&&) noexcept = default;
 
         S const& string() const & noexcept { return string_; }
+        S& string() & noexcept { return string_; }
         S&& string() && noexcept { return std::move(string_); }
         value_type const* data() const noexcept { return string_.data(); }
         size_type size() const noexcept { return string_.size(); }
@@ -7,7 +7,9 @@
 
 #include <cerrno>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <system_error>
 
 
@@ -35,6 +37,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "io.hpp"
+
 #endif
 
 
@@ -162,17 +166,27 @@
 		
 		bool write(std::string_view sv, std::error_code& ec) noexcept {
 #if defined(_WIN32)
-			if(!WriteFile(handle_, text_.data(), text_.size(), nullptr, nullptr)) {
+			if(!WriteFile(handle_, sv.data(), DWORD(sv.size()), nullptr, nullptr)) {
 				ec = {int(GetLastError()), std::system_category()};
 				return false;
 			}
+			return true;
 #else
-			if(::write(handle_, text_.data(), text_.size()) == -1) {
-				ec = {errno, std::system_category()};
-				return false;
-			}
+			return detail::io::write_all(handle_, sv.data(), sv.size(), ec);
 #endif
+		}
+		
+		
+		// Writes all texts with one writev per IOV_MAX of them
+		bool write_all(std::span<text const* const> texts, std::error_code& ec) noexcept {
+#if defined(_WIN32)
+			for(auto const* t: texts)
+				if(!write(t->view(), ec))
+					return false;
 			return true;
+#else
+			return detail::io::write_gathered(handle_, texts, ec);
+#endif
 		}
 
 		
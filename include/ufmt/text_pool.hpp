@@ -0,0 +1,144 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "text.hpp"
+
+
+namespace ufmt {
+
+
+    template<class T = text> class text_pool;
+
+
+    namespace detail::pool {
+
+        template<class T> struct node {
+            T text;
+            node* next{nullptr};
+            text_pool<T>* pool{nullptr};
+        }; // node
+
+    } // namespace detail::pool
+
+
+    // Owns a pooled text, moving it to another thread moves a pointer,
+    // the text goes back to its pool when the handle is destroyed
+    template<class T = text> class text_handle {
+        detail::pool::node<T>* node_{nullptr};
+
+        explicit text_handle(detail::pool::node<T>* node) noexcept: node_{node} { }
+
+        friend class text_pool<T>;
+
+    public:
+
+        text_handle() noexcept = default;
+        ~text_handle() { reset(); }
+        text_handle(text_handle const&) = delete;
+        text_handle& operator = (text_handle const&) = delete;
+
+        text_handle(text_handle&& other) noexcept: node_{std::exchange(other.node_, nullptr)} { }
+
+        text_handle& operator = (text_handle&& other) noexcept {
+            if(this == &other)
+                return *this;
+            reset();
+            node_ = std::exchange(other.node_, nullptr);
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return node_ != nullptr; }
+
+        T& operator * () const noexcept { return node_->text; }
+        T* operator -> () const noexcept { return &node_->text; }
+        T* get() const noexcept { return node_ ? &node_->text : nullptr; }
+
+
+        // Returns the text to its pool, callable from any thread
+        void reset() noexcept {
+            if(node_ == nullptr)
+                return;
+            node_->pool->recycle(std::exchange(node_, nullptr));
+        }
+    }; // text_handle
+
+
+    // Free list of texts for one producer thread. Consumers return texts
+    // through a lock-free stack; acquire() takes the whole stack at once,
+    // so there is a single popper and no ABA. Recycled texts keep their
+    // capacity, in steady state nothing is allocated or copied.
+    // The pool must outlive its handles
+    template<class T> class text_pool {
+        using node = detail::pool::node<T>;
+
+        alignas(64) std::atomic<node*> returned_{nullptr};
+        alignas(64) node* free_{nullptr};
+        std::vector<std::unique_ptr<node>> nodes_;
+        std::size_t reserve_;
+
+        friend class text_handle<T>;
+
+    public:
+
+        // Preallocates texts of reserve capacity each
+        explicit text_pool(std::size_t texts = 0, std::size_t reserve = 0): reserve_{reserve} {
+            for(std::size_t i = 0; i != texts; ++i) {
+                auto* n = allocate();
+                n->next = free_;
+                free_ = n;
+            }
+        }
+
+        text_pool(text_pool const&) = delete;
+        text_pool& operator = (text_pool const&) = delete;
+
+
+        // Texts allocated so far, stops growing once the pool covers the texts in flight
+        std::size_t allocated() const noexcept { return nodes_.size(); }
+
+
+        // Empty text, called by the owning thread only
+        text_handle<T> acquire() {
+            if(free_ == nullptr)
+                free_ = returned_.exchange(nullptr, std::memory_order_acquire);
+            if(free_ == nullptr)
+                return text_handle<T>{allocate()};
+            auto* n = free_;
+            free_ = n->next;
+            return text_handle<T>{n};
+        }
+
+
+    private:
+
+        node* allocate() {
+            nodes_.push_back(std::make_unique<node>());
+            auto* n = nodes_.back().get();
+            n->pool = this;
+            if(reserve_ != 0)
+                n->text.reserve(reserve_);
+            return n;
+        }
+
+
+        void recycle(node* n) noexcept {
+            n->text.clear();
+            n->next = returned_.load(std::memory_order_relaxed);
+            while(!returned_.compare_exchange_weak(n->next, n, std::memory_order_release,
+                                                   std::memory_order_relaxed))
+                ;
+        }
+    }; // text_pool
+
+} // namespace ufmt
@@ -0,0 +1,186 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+namespace ufmt::detail::uring {
+
+
+    // Minimal io_uring over raw system calls, single threaded use
+    class ring {
+        int fd_{-1};
+        void* sq_ring_{MAP_FAILED};
+        void* cq_ring_{MAP_FAILED};
+        ::io_uring_sqe* sqes_{static_cast<::io_uring_sqe*>(MAP_FAILED)};
+        std::size_t sq_ring_size_{0};
+        std::size_t cq_ring_size_{0};
+        std::size_t sqes_size_{0};
+
+        unsigned* sq_head_{nullptr};
+        unsigned* sq_tail_{nullptr};
+        unsigned sq_mask_{0};
+        unsigned sq_entries_{0};
+        unsigned local_tail_{0};
+
+        unsigned* cq_head_{nullptr};
+        unsigned* cq_tail_{nullptr};
+        unsigned cq_mask_{0};
+        ::io_uring_cqe* cqes_{nullptr};
+
+    public:
+
+        ring() noexcept = default;
+        ring(ring const&) = delete;
+        ring& operator = (ring const&) = delete;
+
+        ~ring() { close(); }
+
+
+        explicit operator bool () const noexcept { return fd_ != -1; }
+
+
+        bool open(unsigned entries, std::error_code& ec) noexcept {
+            ::io_uring_params params{};
+            fd_ = int(::syscall(__NR_io_uring_setup, entries, &params));
+            if(fd_ == -1) {
+                ec = {errno, std::system_category()};
+                return false;
+            }
+
+            sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+            auto const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if(single_mmap)
+                sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+            sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+            if(sq_ring_ == MAP_FAILED)
+                return fail(ec);
+            cq_ring_ = single_mmap ? sq_ring_
+                                   : ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            if(cq_ring_ == MAP_FAILED)
+                return fail(ec);
+            sqes_size_ = params.sq_entries * sizeof(::io_uring_sqe);
+            sqes_ = static_cast<::io_uring_sqe*>(::mmap(nullptr, sqes_size_,
+                                                        PROT_READ | PROT_WRITE,
+                                                        MAP_SHARED | MAP_POPULATE,
+                                                        fd_, IORING_OFF_SQES));
+            if(sqes_ == MAP_FAILED)
+                return fail(ec);
+
+            auto* sq = static_cast<char*>(sq_ring_);
+            sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_entries_ = params.sq_entries;
+            local_tail_ = *sq_tail_;
+            // submission slots map to entries one to one
+            auto* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            for(unsigned i = 0; i != sq_entries_; ++i)
+                array[i] = i;
+
+            auto* cq = static_cast<char*>(cq_ring_);
+            cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<::io_uring_cqe*>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+
+        void close() noexcept {
+            if(sqes_ != MAP_FAILED)
+                ::munmap(sqes_, sqes_size_);
+            if(cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+                ::munmap(cq_ring_, cq_ring_size_);
+            if(sq_ring_ != MAP_FAILED)
+                ::munmap(sq_ring_, sq_ring_size_);
+            sqes_ = static_cast<::io_uring_sqe*>(MAP_FAILED);
+            cq_ring_ = sq_ring_ = MAP_FAILED;
+            if(fd_ != -1)
+                ::close(fd_);
+            fd_ = -1;
+        }
+
+
+        bool register_buffers(::iovec const* buffers, unsigned count,
+                              std::error_code& ec) noexcept {
+            if(::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                         buffers, count) == -1) {
+                ec = {errno, std::system_category()};
+                return false;
+            }
+            return true;
+        }
+
+
+        // Zeroed submission entry or nullptr when the queue is full
+        ::io_uring_sqe* acquire() noexcept {
+            auto const head = std::atomic_ref{*sq_head_}.load(std::memory_order_acquire);
+            if(local_tail_ - head >= sq_entries_)
+                return nullptr;
+            auto* sqe = &sqes_[local_tail_ & sq_mask_];
+            std::memset(sqe, 0, sizeof(::io_uring_sqe));
+            ++local_tail_;
+            return sqe;
+        }
+
+
+        // Submits acquired entries and optionally waits for completions
+        bool submit(unsigned wait_for, std::error_code& ec) noexcept {
+            std::atomic_ref{*sq_tail_}.store(local_tail_, std::memory_order_release);
+            for(;;) {
+                auto const head = std::atomic_ref{*sq_head_}.load(std::memory_order_acquire);
+                auto const flags = wait_for != 0 ? IORING_ENTER_GETEVENTS : 0u;
+                if(::syscall(__NR_io_uring_enter, fd_, local_tail_ - head, wait_for,
+                             flags, nullptr, 0) != -1)
+                    return true;
+                if(errno == EINTR)
+                    continue;
+                ec = {errno, std::system_category()};
+                return false;
+            }
+        }
+
+
+        // Calls f for every available completion without blocking
+        template<typename F>
+        unsigned reap(F&& f) {
+            auto head = *cq_head_;
+            auto const tail = std::atomic_ref{*cq_tail_}.load(std::memory_order_acquire);
+            unsigned reaped = 0;
+            for(; head != tail; ++head, ++reaped)
+                f(cqes_[head & cq_mask_]);
+            std::atomic_ref{*cq_head_}.store(head, std::memory_order_release);
+            return reaped;
+        }
+
+
+    private:
+
+        bool fail(std::error_code& ec) noexcept {
+            ec = {errno, std::system_category()};
+            close();
+            return false;
+        }
+    }; // ring
+
+} // namespace ufmt::detail::uring
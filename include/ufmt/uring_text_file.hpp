@@ -0,0 +1,305 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "aligned_string.hpp"
+#include "io.hpp"
+#include "text.hpp"
+#include "uring.hpp"
+
+
+namespace ufmt {
+
+
+    struct uring_options {
+        unsigned buffers{4};              // rotated buffers, at most all but one in flight
+        std::size_t buffer_size{65536};   // submit a buffer once it holds this much
+        bool fallback{false};             // write synchronously even if io_uring is available
+    }; // uring_options
+
+
+    // Formats into one of several registered buffers while the others
+    // are written by io_uring at explicit offsets
+    template<class T = aligned_text> class uring_text_file {
+
+        struct buffer {
+            T text;
+            std::uint64_t offset{0};
+            bool in_flight{false};
+        }; // buffer
+
+        int handle_{-1};
+        std::unique_ptr<detail::uring::ring> ring_;
+        std::vector<buffer> buffers_;
+        std::vector<::iovec> registered_;
+        std::size_t current_{0};
+        std::size_t buffer_size_;
+        std::uint64_t offset_{0};
+        bool rejected_{false};
+        std::error_code error_;
+
+        uring_text_file(int handle, std::uint64_t offset, uring_options const& options)
+            : handle_{handle},
+              buffers_(options.buffers < 2 ? 2 : options.buffers),
+              buffer_size_{options.buffer_size == 0 ? 1 : options.buffer_size},
+              offset_{offset} {
+            for(auto& b: buffers_)
+                b.text.reserve(buffer_size_);
+            if(options.fallback)
+                return;
+            std::error_code ec;
+            ring_ = std::make_unique<detail::uring::ring>();
+            if(!ring_->open(unsigned(buffers_.size()), ec)) {
+                ring_.reset();
+                return;
+            }
+            registered_.reserve(buffers_.size());
+            for(auto& b: buffers_)
+                registered_.push_back(::iovec{const_cast<char*>(b.text.data()), b.text.capacity()});
+            if(!ring_->register_buffers(registered_.data(), unsigned(registered_.size()), ec))
+                registered_.clear();
+        }
+
+        static std::optional<uring_text_file> open(std::string const& path, int flags,
+                                                   bool append, uring_options const& options,
+                                                   std::error_code& ec) {
+            auto const opened = ::open(path.data(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+            if(opened == -1) {
+                ec = {errno, std::system_category()};
+                return std::nullopt;
+            }
+            std::uint64_t offset = 0;
+            if(append) {
+                auto const end = ::lseek(opened, 0, SEEK_END);
+                if(end == -1) {
+                    ec = {errno, std::system_category()};
+                    ::close(opened);
+                    return std::nullopt;
+                }
+                offset = std::uint64_t(end);
+            }
+            return uring_text_file{opened, offset, options};
+        }
+
+    public:
+
+        static std::optional<uring_text_file> create_always(std::string const& path,
+                                                            std::error_code& ec,
+                                                            uring_options const& options = {}) {
+            return open(path, O_CREAT | O_TRUNC | O_WRONLY, false, options, ec);
+        }
+
+
+        static std::optional<uring_text_file> open_existing(std::string const& path,
+                                                            std::error_code& ec,
+                                                            uring_options const& options = {}) {
+            return open(path, O_WRONLY, false, options, ec);
+        }
+
+
+        // Appends at the end of file as it was when opened, positional writes
+        // do not interleave atomically with other appending processes
+        static std::optional<uring_text_file> open_always_to_append(std::string const& path,
+                                                                    std::error_code& ec,
+                                                                    uring_options const& options = {}) {
+            return open(path, O_CREAT | O_WRONLY, true, options, ec);
+        }
+
+
+        ~uring_text_file() noexcept { close(); }
+        uring_text_file(uring_text_file const&) = delete;
+        uring_text_file& operator = (uring_text_file const&) = delete;
+
+
+        uring_text_file(uring_text_file&& other) noexcept
+            : handle_{std::exchange(other.handle_, -1)},
+              ring_{std::move(other.ring_)},
+              buffers_{std::move(other.buffers_)},
+              registered_{std::move(other.registered_)},
+              current_{other.current_},
+              buffer_size_{other.buffer_size_},
+              offset_{other.offset_},
+              rejected_{other.rejected_},
+              error_{other.error_} { }
+
+
+        uring_text_file& operator = (uring_text_file&& other) noexcept {
+            if(this == &other)
+                return *this;
+            close();
+            handle_ = std::exchange(other.handle_, -1);
+            ring_ = std::move(other.ring_);
+            buffers_ = std::move(other.buffers_);
+            registered_ = std::move(other.registered_);
+            current_ = other.current_;
+            buffer_size_ = other.buffer_size_;
+            offset_ = other.offset_;
+            rejected_ = other.rejected_;
+            error_ = other.error_;
+            return *this;
+        }
+
+
+        explicit operator bool () const noexcept { return handle_ != -1; }
+
+        // False when writes fell back to plain write(2), also after
+        // the kernel rejected the write opcodes
+        bool uring() const noexcept { return ring_ != nullptr; }
+        bool registered() const noexcept { return !registered_.empty(); }
+
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        void close() noexcept {
+            if(handle_ == -1)
+                return;
+            flush();
+            ring_.reset();
+            ::close(handle_);
+            handle_ = -1;
+        }
+
+
+        // Submits the current buffer and waits for all writes to complete
+        bool flush() noexcept {
+            if(!buffers_[current_].text.empty() && !buffers_[current_].in_flight)
+                submit_current();
+            while(ring_ && in_flight() != 0) {
+                std::error_code ec;
+                if(!ring_->submit(1, ec)) {
+                    error_ = ec;
+                    break;
+                }
+                reap();
+            }
+            return !error_;
+        }
+
+
+        // Refused once the ring failed with the current buffer still owned by the kernel
+        bool write(std::string_view sv) noexcept {
+            if(buffers_[current_].in_flight)
+                return false;
+            auto& current = buffers_[current_].text;
+            current.append(sv.data(), sv.size());
+            if(current.size() >= buffer_size_)
+                submit_current();
+            return !error_;
+        }
+
+
+        template<typename... Args>
+        void print(Args&&... args) {
+            if(buffers_[current_].in_flight)
+                return;
+            auto& current = buffers_[current_].text;
+            current.format(std::forward<Args>(args)..., '\n');
+            if(current.size() >= buffer_size_)
+                submit_current();
+        }
+
+
+    private:
+
+        std::size_t in_flight() const noexcept {
+            std::size_t n = 0;
+            for(auto const& b: buffers_)
+                n += b.in_flight ? 1 : 0;
+            return n;
+        }
+
+
+        void submit_current() noexcept {
+            auto& b = buffers_[current_];
+            b.offset = offset_;
+            offset_ += b.text.size();
+
+            auto* sqe = ring_ ? ring_->acquire() : nullptr;
+            if(sqe == nullptr) {
+                std::error_code ec;
+                if(!detail::io::pwrite_all(handle_, b.text.data(), b.text.size(), b.offset, ec))
+                    error_ = ec;
+                b.text.clear();
+                return;
+            }
+
+            // a buffer grown past its registration is written as a plain one,
+            // capacity only grows so a reused address is not mistaken for it
+            auto const fixed = current_ < registered_.size()
+                               && registered_[current_].iov_base == b.text.data()
+                               && registered_[current_].iov_len == b.text.capacity();
+            sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->fd = handle_;
+            sqe->addr = std::uint64_t(reinterpret_cast<std::uintptr_t>(b.text.data()));
+            sqe->len = unsigned(b.text.size());
+            sqe->off = b.offset;
+            sqe->buf_index = fixed ? std::uint16_t(current_) : 0;
+            sqe->user_data = current_;
+            b.in_flight = true;
+
+            std::error_code ec;
+            if(!ring_->submit(0, ec))
+                error_ = ec;
+
+            // the next buffer is formatted into only after its write completed,
+            // if the ring fails first it stays in flight and writes are refused
+            current_ = (current_ + 1) % buffers_.size();
+            reap();
+            while(ring_ && buffers_[current_].in_flight) {
+                if(!ring_->submit(1, ec)) {
+                    error_ = ec;
+                    break;
+                }
+                reap();
+            }
+        }
+
+
+        void reap() noexcept {
+            ring_->reap([this](::io_uring_cqe const& cqe) {
+                auto& b = buffers_[std::size_t(cqe.user_data)];
+                auto const size = b.text.size();
+                if(cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                    // the kernel does not know the opcode, writes go through write(2)
+                    rejected_ = true;
+                    std::error_code ec;
+                    if(!detail::io::pwrite_all(handle_, b.text.data(), size, b.offset, ec))
+                        error_ = ec;
+                } else if(cqe.res < 0) {
+                    error_ = {-cqe.res, std::system_category()};
+                } else if(std::size_t(cqe.res) < size) {
+                    std::error_code ec;
+                    if(!detail::io::pwrite_all(handle_, b.text.data() + cqe.res,
+                                               size - std::size_t(cqe.res),
+                                               b.offset + std::uint64_t(cqe.res), ec))
+                        error_ = ec;
+                }
+                b.text.clear();
+                b.in_flight = false;
+            });
+            if(rejected_ && in_flight() == 0) {
+                ring_.reset();
+                registered_.clear();
+            }
+        }
+    }; // uring_text_file
+
+} // namespace ufmt
@@ -0,0 +1,137 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+namespace ufmt::detail {
+
+
+    // Hands out ranges with fetch_add and tracks the length below which
+    // every range is committed, ranges may complete in any order.
+    // A thread holds at most one uncommitted range of a watermark
+    class watermark {
+        static constexpr auto idle = ~std::uint64_t(0);
+
+        struct alignas(64) slot {
+            std::atomic<std::uint64_t> begin{idle};
+            std::atomic<bool> abandoned{false};     // the thread has exited
+            std::atomic<bool> retired{false};       // the watermark is gone
+        }; // slot
+
+        struct local {
+            std::uint64_t owner;
+            std::shared_ptr<slot> s;
+        }; // local
+
+
+        // Slots of the thread by watermark
+        struct locals {
+            std::vector<local> entries;
+
+            ~locals() {
+                for(auto& l: entries)
+                    l.s->abandoned.store(true, std::memory_order_release);
+            }
+        }; // locals
+
+        static inline std::atomic<std::uint64_t> instances{0};
+
+        alignas(64) std::atomic<std::uint64_t> reserved_;
+        std::uint64_t id_{instances.fetch_add(1) + 1};
+        std::mutex sync_;
+        std::vector<std::shared_ptr<slot>> slots_;
+
+    public:
+
+        explicit watermark(std::uint64_t start = 0) noexcept: reserved_{start} { }
+
+        ~watermark() {
+            for(auto const& s: slots_)
+                s->retired.store(true, std::memory_order_relaxed);
+        }
+
+        watermark(watermark const&) = delete;
+        watermark& operator = (watermark const&) = delete;
+
+
+        // Starts over from start, should not race with reserve()
+        void reset(std::uint64_t start = 0) noexcept {
+            reserved_.store(start, std::memory_order_release);
+        }
+
+
+        // Start of the range of size units
+        std::uint64_t reserve(std::size_t size) {
+            auto& s = local_slot();
+            // every range not committed yet starts at or after its slot value
+            s.begin.store(reserved_.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+            auto const begin = reserved_.fetch_add(size, std::memory_order_seq_cst);
+            s.begin.store(begin, std::memory_order_release);
+            return begin;
+        }
+
+
+        void commit() {
+            local_slot().begin.store(idle, std::memory_order_release);
+        }
+
+
+        std::uint64_t reserved() const noexcept {
+            return reserved_.load(std::memory_order_acquire);
+        }
+
+
+        // Everything below is committed, slots of exited threads are dropped
+        std::uint64_t committed() {
+            auto mark = reserved_.load(std::memory_order_seq_cst);
+            std::unique_lock g{sync_};
+            std::erase_if(slots_, [](auto const& s) {
+                return s->abandoned.load(std::memory_order_acquire);
+            });
+            for(auto const& s: slots_)
+                mark = std::min(mark, s->begin.load(std::memory_order_seq_cst));
+            return mark;
+        }
+
+
+        // Threads that reserved and are still running
+        std::size_t threads() {
+            std::unique_lock g{sync_};
+            return slots_.size();
+        }
+
+
+    private:
+
+        slot& local_slot() {
+            thread_local locals current;
+            auto& entries = current.entries;
+            for(auto const& l: entries)
+                if(l.owner == id_)
+                    return *l.s;
+            std::erase_if(entries, [](auto const& l) {
+                return l.s->retired.load(std::memory_order_relaxed);
+            });
+            auto created = std::make_shared<slot>();
+            {
+                std::unique_lock g{sync_};
+                slots_.push_back(created);
+            }
+            entries.push_back(local{id_, created});
+            return *created;
+        }
+    }; // watermark
+
+} // namespace ufmt::detail
@@ -0,0 +1,139 @@
+// This file is part of ufmt library
+// Copyright 2020-2022 Andrei Ilin <ortfero@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace ufmt::detail {
+
+
+    // Ring of buffers, the producer fills one while the I/O thread passes
+    // the submitted ones to write(data, size, ec) in order
+    template<class T, class Write> class write_behind {
+        std::vector<T> buffers_;
+        std::vector<std::size_t> sizes_;
+        Write write_;
+        std::size_t filling_{0};
+        std::uint64_t stalls_{0};
+        std::chrono::steady_clock::duration stall_time_{};
+        std::error_code error_;
+
+        alignas(64) std::atomic<std::size_t> submitted_{0};
+        alignas(64) std::atomic<std::size_t> completed_{0};
+        std::atomic<std::uint32_t> signal_{0};
+        std::atomic<bool> stopping_{false};
+        std::thread thread_;
+
+    public:
+
+        write_behind(std::size_t buffers, std::size_t buffer_size, Write write)
+            : buffers_(buffers < 2 ? 2 : buffers), sizes_(buffers_.size()),
+              write_{std::move(write)} {
+            for(auto& b: buffers_)
+                b.reserve(buffer_size);
+            thread_ = std::thread{[this] { run(); }};
+        }
+
+        write_behind(write_behind const&) = delete;
+        write_behind& operator = (write_behind const&) = delete;
+
+        ~write_behind() { stop(); }
+
+
+        // Buffer owned by the producer
+        T& current() noexcept { return buffers_[filling_ % buffers_.size()]; }
+        T const& current() const noexcept { return buffers_[filling_ % buffers_.size()]; }
+
+        std::size_t buffers() const noexcept { return buffers_.size(); }
+
+        // Times the producer waited for a free buffer and how long in total
+        std::uint64_t stalls() const noexcept { return stalls_; }
+        std::chrono::steady_clock::duration stall_time() const noexcept { return stall_time_; }
+
+        // First write failure, valid after drain()
+        std::error_code const& error() const noexcept { return error_; }
+
+
+        // Hands the first size bytes of the current buffer to the I/O thread,
+        // returns the next buffer once it is written out and cleared
+        T& submit(std::size_t size) {
+            sizes_[filling_ % buffers_.size()] = size;
+            ++filling_;
+            submitted_.store(filling_, std::memory_order_release);
+            wake();
+
+            auto const reusable = filling_ < buffers_.size() ? 0 : filling_ + 1 - buffers_.size();
+            auto done = completed_.load(std::memory_order_acquire);
+            if(done < reusable) {
+                auto const started = std::chrono::steady_clock::now();
+                ++stalls_;
+                do {
+                    completed_.wait(done, std::memory_order_acquire);
+                    done = completed_.load(std::memory_order_acquire);
+                } while(done < reusable);
+                stall_time_ += std::chrono::steady_clock::now() - started;
+            }
+            auto& next = current();
+            next.clear();
+            return next;
+        }
+
+
+        // Waits until every submitted buffer is written
+        void drain() noexcept {
+            auto const target = filling_;
+            for(auto done = completed_.load(std::memory_order_acquire); done < target;
+                done = completed_.load(std::memory_order_acquire))
+                completed_.wait(done, std::memory_order_acquire);
+        }
+
+
+        void stop() noexcept {
+            if(!thread_.joinable())
+                return;
+            drain();
+            stopping_.store(true, std::memory_order_release);
+            wake();
+            thread_.join();
+        }
+
+
+    private:
+
+        void wake() noexcept {
+            signal_.fetch_add(1, std::memory_order_release);
+            signal_.notify_one();
+        }
+
+
+        void run() noexcept {
+            for(std::size_t done = 0;;) {
+                auto const signal = signal_.load(std::memory_order_acquire);
+                if(submitted_.load(std::memory_order_acquire) == done) {
+                    if(stopping_.load(std::memory_order_acquire))
+                        return;
+                    signal_.wait(signal, std::memory_order_acquire);
+                    continue;
+                }
+                auto const index = done % buffers_.size();
+                std::error_code ec;
+                if(!write_(buffers_[index].data(), sizes_[index], ec) && !error_)
+                    error_ = ec;
+                completed_.store(++done, std::memory_order_release);
+                completed_.notify_one();
+            }
+        }
+    }; // write_behind
+
+} // namespace ufmt::detail
@@ -0,0 +1,119 @@
+#pragma once
+
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/async_print.hpp>
+
+
+namespace {
+
+    std::string read_all(std::FILE* file) {
+        std::string content;
+        std::rewind(file);
+        char chunk[4096];
+        for(auto n = std::fread(chunk, 1, sizeof(chunk), file); n != 0;
+            n = std::fread(chunk, 1, sizeof(chunk), file))
+            content.append(chunk, n);
+        return content;
+    }
+
+}
+
+
+TEST_SUITE("async_print") {
+
+
+    SCENARIO("Flush writes every queued line in order") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        ufmt::async_printer target{{.capacity = 8, .fd = fileno(file)}};
+        std::string expected;
+        for(auto i = 0; i != 100; ++i) {
+            REQUIRE(target.print("line ", i));
+            expected += ufmt::text::of("line ", i, '\n');
+        }
+        target.flush();
+        REQUIRE_EQ(read_all(file), expected);
+        std::fclose(file);
+    }
+
+
+    SCENARIO("Stop loses no lines from several threads") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            ufmt::async_printer target{{.capacity = 16, .fd = fileno(file)}};
+            std::vector<std::thread> producers;
+            for(auto t = 0; t != 4; ++t)
+                producers.emplace_back([&target, t] {
+                    for(auto i = 0; i != 1000; ++i)
+                        target.print(t, ':', i);
+                });
+            for(auto& producer: producers)
+                producer.join();
+        }
+        auto const content = read_all(file);
+        std::size_t lines = 0;
+        for(auto c: content)
+            lines += c == '\n';
+        REQUIRE_EQ(lines, 4000);
+        std::fclose(file);
+    }
+
+
+    SCENARIO("Dropped lines are counted") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        ufmt::async_printer target{{.capacity = 2,
+                                    .overflow = ufmt::backpressure::drop_newest,
+                                    .fd = fileno(file)}};
+        auto accepted = 0u;
+        for(auto i = 0; i != 10000; ++i)
+            accepted += target.print(i) ? 1 : 0;
+        target.stop();
+        REQUIRE_EQ(accepted + target.dropped(), 10000);
+        std::fclose(file);
+    }
+
+
+    SCENARIO("Counted drops are reported in the output") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        ufmt::async_printer target{{.capacity = 2,
+                                    .overflow = ufmt::backpressure::drop_counted,
+                                    .fd = fileno(file)}};
+        auto accepted = 0u;
+        for(auto i = 0; i != 10000; ++i)
+            accepted += target.print("line ", i) ? 1 : 0;
+        target.stop();
+        REQUIRE_GT(target.dropped(), 0);
+
+        auto const content = read_all(file);
+        std::uint64_t reported = 0;
+        auto lines = 0u;
+        for(std::size_t begin = 0, end; begin != content.size(); begin = end + 1) {
+            end = content.find('\n', begin);
+            REQUIRE_NE(end, std::string::npos);
+            auto const line = std::string_view{content}.substr(begin, end - begin);
+            if(line.starts_with("ufmt: ")) {
+                REQUIRE(line.ends_with(" lines dropped"));
+                reported += std::stoull(std::string{line.substr(6)});
+            } else {
+                REQUIRE(line.starts_with("line "));
+                ++lines;
+            }
+        }
+        REQUIRE_EQ(lines, accepted);
+        REQUIRE_EQ(reported, target.dropped());
+        std::fclose(file);
+    }
+}
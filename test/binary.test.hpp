@@ -0,0 +1,74 @@
+#pragma once
+
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <system_error>
+
+#include "doctest.h"
+
+#include <ufmt/binary.hpp>
+
+
+TEST_SUITE("binary") {
+
+
+    SCENARIO("Decoded binary log matches text formatting") {
+        auto const path = std::string{"ufmt-binary.test.log"};
+        std::error_code ec;
+        std::string expected;
+        {
+            auto log = ufmt::binary_log::create_always(path, ec);
+            REQUIRE(log);
+            ufmt::binary_writer writer{*log, 64};
+            std::string const name{"qwerty"};
+            char buffer[] = "mutable";
+            for(auto i = 0; i != 10; ++i) {
+                UFMT_BINARY_PRINT(writer, "i: ", i, ", x: ", -127562.127562, ", name: ", name);
+                expected += ufmt::text::of("i: ", i, ", x: ", -127562.127562, ", name: ", name, '\n');
+                UFMT_BINARY_PRINT(writer, buffer, ' ', ufmt::fixed(i, 3), ' ',
+                                  ufmt::precised(0.5, 2), ' ', std::uint64_t(i), 1.5f);
+                expected += ufmt::text::of(buffer, ' ', ufmt::fixed(i, 3), ' ',
+                                           ufmt::precised(0.5, 2), ' ', std::uint64_t(i), 1.5f, '\n');
+                buffer[0] = char('a' + i);
+                char const code[] = {char('a' + i), 'x', '\0'};
+                UFMT_BINARY_PRINT(writer, "code: ", code, "; ", (std::pair<int, int>{i, 2}.first));
+                expected += ufmt::text::of("code: ", code, "; ", i, '\n');
+            }
+            UFMT_BINARY_PRINT(writer, "long: ", std::string(200, '*'));
+            expected += ufmt::text::of("long: ", std::string(200, '*'), '\n');
+        }
+        std::ifstream file{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{file}, {}};
+        ufmt::text decoded;
+        REQUIRE(ufmt::decode_binary_log(content, decoded));
+        REQUIRE_EQ(decoded.string(), expected);
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Malformed binary log is rejected") {
+        ufmt::text decoded;
+        REQUIRE_FALSE(ufmt::decode_binary_log("not a binary log", decoded));
+
+        auto const log = [](std::string body) {
+            return std::string{"UFMTBIN1"} + body;
+        };
+        auto const word = [](std::uint32_t value) {
+            return std::string{reinterpret_cast<char const*>(&value), sizeof(value)};
+        };
+        REQUIRE(ufmt::decode_binary_log(log("D" + word(0) + word(0)), decoded));
+        REQUIRE_FALSE(ufmt::decode_binary_log(log("D" + word(0xFFFFFFFF) + word(0)), decoded));
+        REQUIRE_FALSE(ufmt::decode_binary_log(log("D" + word(1000000000) + word(0)), decoded));
+        REQUIRE_FALSE(ufmt::decode_binary_log(log("D" + word(0) + word(0) + "D" + word(0) + word(0)),
+                                              decoded));
+        REQUIRE_FALSE(ufmt::decode_binary_log(log("D" + word(0) + word(0xFFFFFFFF)), decoded));
+        REQUIRE_FALSE(ufmt::decode_binary_log(log("R" + word(4) + word(0)), decoded));
+        REQUIRE_FALSE(ufmt::decode_binary_log(log("D" + word(0) + word(0) + "R" + word(100) + word(0)),
+                                              decoded));
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "doctest.h"
+
+#include <ufmt/buffered_file.hpp>
+
+
+TEST_SUITE("buffered_file") {
+
+
+    SCENARIO("Aligned text keeps its buffer aligned while growing") {
+        ufmt::aligned_text text;
+        std::string expected;
+        for(auto i = 0; i != 1000; ++i) {
+            text.format("line ", i, ' ', -127562.127562, '\n');
+            expected += ufmt::text::of("line ", i, ' ', -127562.127562, '\n');
+            REQUIRE_EQ(std::uintptr_t(text.data()) % 4096, 0);
+        }
+        REQUIRE_EQ(std::string{text.view()}, expected);
+    }
+
+
+    SCENARIO("Lines reach the file only when the buffer is full or flushed") {
+        auto const path = std::string{"ufmt-buffered_file.test.log"};
+        std::error_code ec;
+        auto file = ufmt::buffered_file<>::create_always(path, ec, 4096);
+        REQUIRE(file);
+        auto const content = [&] {
+            std::ifstream in{path, std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>{in}, {}};
+        };
+
+        file->print("first ", 1);
+        REQUIRE(content().empty());
+        REQUIRE(file->flush());
+        REQUIRE_EQ(content(), "first 1\n");
+
+        std::string expected = "first 1\n";
+        for(auto i = 0; i != 1000; ++i) {
+            file->print("line ", i);
+            expected += ufmt::text::of("line ", i, '\n');
+        }
+        REQUIRE_LT(file->buffered(), file->buffer_size());
+        REQUIRE_EQ(content(), expected.substr(0, expected.size() - file->buffered()));
+
+        std::string const big(10000, '*');
+        REQUIRE(file->write(big, ec));
+        expected += big;
+
+        auto moved = std::move(*file);
+        moved.print("last");
+        expected += "last\n";
+        moved.close();
+        REQUIRE_EQ(content(), expected);
+        REQUIRE_FALSE(moved.error());
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Buffered file works over std::string text") {
+        auto const path = std::string{"ufmt-buffered_file-string.test.log"};
+        std::error_code ec;
+        {
+            auto file = ufmt::buffered_file<ufmt::text>::create_always(path, ec, 16);
+            REQUIRE(file);
+            for(auto i = 0; i != 10; ++i)
+                file->print(i, ' ', ufmt::quoted("value"));
+        }
+        std::ifstream in{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{in}, {}};
+        std::string expected;
+        for(auto i = 0; i != 10; ++i)
+            expected += ufmt::text::of(i, ' ', ufmt::quoted("value"), '\n');
+        REQUIRE_EQ(content, expected);
+        std::remove(path.data());
+    }
+
+
+
+    SCENARIO("Write-behind buffers reach the file in order") {
+        auto const path = std::string{"ufmt-buffered_file-behind.test.log"};
+        std::error_code ec;
+        auto file = ufmt::buffered_file<>::create_always(path, ec, 4096, 3);
+        REQUIRE(file);
+        REQUIRE_EQ(file->write_behind(), 3);
+        auto const content = [&] {
+            std::ifstream in{path, std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>{in}, {}};
+        };
+
+        std::string expected;
+        for(auto i = 0; i != 20000; ++i) {
+            file->print("line ", i, ' ', -127562.127562);
+            expected += ufmt::text::of("line ", i, ' ', -127562.127562, '\n');
+        }
+        std::string const big(10000, '*');
+        REQUIRE(file->write(big, ec));
+        expected += big;
+        REQUIRE(file->flush());
+        REQUIRE_EQ(file->buffered(), 0);
+        REQUIRE_EQ(content(), expected);
+
+        auto moved = std::move(*file);
+        moved.print("last");
+        expected += "last\n";
+        moved.close();
+        REQUIRE_EQ(content(), expected);
+        REQUIRE_FALSE(moved.error());
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Write-behind counts stalls behind a slow reader") {
+        auto const path = std::string{"ufmt-buffered_file-stall.test.fifo"};
+        std::remove(path.data());
+        REQUIRE_EQ(::mkfifo(path.data(), 0600), 0);
+        std::string received;
+        std::thread reader{[&] {
+            std::ifstream in{path, std::ios::binary};
+            char chunk[64];
+            while(in.read(chunk, sizeof(chunk)) || in.gcount() != 0) {
+                received.append(chunk, std::size_t(in.gcount()));
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+        }};
+
+        std::string expected;
+        std::error_code ec;
+        {
+            auto file = ufmt::buffered_file<ufmt::text>::create_always(path, ec, 64, 2);
+            REQUIRE(file);
+            for(auto i = 0; i != 200; ++i) {
+                file->print("line ", i, ' ', -127562.127562);
+                expected += ufmt::text::of("line ", i, ' ', -127562.127562, '\n');
+            }
+            file->close();
+            REQUIRE_GT(file->stalls(), 0);
+            REQUIRE_GT(file->stall_time().count(), 0);
+        }
+        reader.join();
+        REQUIRE_EQ(received, expected);
+        std::remove(path.data());
+    }
+
+}
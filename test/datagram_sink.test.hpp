@@ -0,0 +1,139 @@
+#pragma once
+
+
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/datagram_sink.hpp>
+
+
+namespace {
+
+    std::vector<std::string> receive_all(int fd) {
+        std::vector<std::string> received;
+        char datagram[65536];
+        for(auto n = ::recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT); n >= 0;
+            n = ::recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT))
+            received.emplace_back(datagram, std::size_t(n));
+        return received;
+    }
+
+} // namespace
+
+
+TEST_SUITE("datagram_sink") {
+
+
+    SCENARIO("Records are gathered and sent one datagram each") {
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, pair), 0);
+        std::error_code ec;
+        {
+            ufmt::datagram_sink sink{pair[0], {.batch = 8, .flush_interval = std::chrono::hours{1}}};
+            for(auto i = 0; i != 20; ++i)
+                REQUIRE(sink.print("record ", i, ' ', -127562.127562));
+            REQUIRE_EQ(sink.pending(), 4);
+            REQUIRE_EQ(sink.batches(), 2);
+            REQUIRE(sink.write("last", ec));
+            REQUIRE(sink.flush());
+            REQUIRE_EQ(sink.pending(), 0);
+            REQUIRE_EQ(sink.batches(), 3);
+        }
+        auto const received = receive_all(pair[1]);
+        REQUIRE_EQ(received.size(), 21);
+        for(auto i = 0; i != 20; ++i)
+            REQUIRE_EQ(received[i], ufmt::text::of("record ", i, ' ', -127562.127562));
+        REQUIRE_EQ(received.back(), "last");
+        ::close(pair[1]);
+    }
+
+
+    SCENARIO("Old records are sent on the next write") {
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, pair), 0);
+        ufmt::datagram_sink sink{pair[0], {.batch = 64,
+                                           .flush_interval = std::chrono::milliseconds{1}}};
+        sink.print("first");
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        sink.print("second");
+        REQUIRE_EQ(sink.pending(), 0);
+        REQUIRE_EQ(receive_all(pair[1]), std::vector<std::string>{"first", "second"});
+        ::close(pair[1]);
+    }
+
+
+    SCENARIO("Idle records are sent by the background timer") {
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_DGRAM, 0, pair), 0);
+        auto sink = ufmt::datagram_sink{pair[0], {.batch = 64,
+                                                  .flush_interval = std::chrono::milliseconds{2},
+                                                  .background_flush = true}};
+        sink.print("idle");
+        std::vector<std::string> received;
+        for(auto i = 0; i != 1000 && received.empty(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{2});
+            received = receive_all(pair[1]);
+        }
+        REQUIRE_EQ(received, std::vector<std::string>{"idle"});
+        REQUIRE_EQ(sink.pending(), 0);
+
+        auto moved = std::move(sink);
+        moved.print("after move");
+        received.clear();
+        for(auto i = 0; i != 1000 && received.empty(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{2});
+            received = receive_all(pair[1]);
+        }
+        REQUIRE_EQ(received, std::vector<std::string>{"after move"});
+        REQUIRE_EQ(moved.batches(), 2);
+        ::close(pair[1]);
+    }
+
+
+    SCENARIO("Full socket drops the batch or waits for the reader") {
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, pair), 0);
+        std::string const record(1000, '*');
+        std::error_code ec;
+        {
+            ufmt::datagram_sink sink{pair[0], {.batch = 16, .overflow = ufmt::backpressure::drop_newest}};
+            for(auto i = 0; i != 10000 && sink.dropped() == 0; ++i)
+                sink.write(record, ec);
+            REQUIRE_GT(sink.dropped(), 0);
+            REQUIRE_EQ(ec, std::errc::resource_unavailable_try_again);
+            receive_all(pair[1]);
+        }
+
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, pair), 0);
+        constexpr auto records = 5000;
+        std::size_t received = 0;
+        std::thread reader{[&] {
+            char datagram[2048];
+            while(received != records) {
+                if(::recv(pair[1], datagram, sizeof(datagram), 0) > 0)
+                    ++received;
+                else
+                    std::this_thread::yield();
+            }
+        }};
+        {
+            ufmt::datagram_sink sink{pair[0], {.batch = 16}};
+            for(auto i = 0; i != records; ++i)
+                REQUIRE(sink.write(record, ec));
+            REQUIRE(sink.flush());
+            REQUIRE_EQ(sink.dropped(), 0);
+        }
+        reader.join();
+        REQUIRE_EQ(received, records);
+        ::close(pair[1]);
+    }
+
+}
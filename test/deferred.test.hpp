@@ -0,0 +1,79 @@
+#pragma once
+
+
+#include <string>
+#include <type_traits>
+
+#include "doctest.h"
+
+#include <ufmt/deferred.hpp>
+
+
+TEST_SUITE("deferred") {
+
+
+    SCENARIO("Render numbers and literals") {
+        auto const target = ufmt::defer("nums: ", -1, ", ", 2u, ", ", -3.5, '!');
+        ufmt::text rendered;
+        target.render(rendered);
+        REQUIRE_EQ(rendered.string(), ufmt::text::of("nums: ", -1, ", ", 2u, ", ", -3.5, '!'));
+    }
+
+
+    SCENARIO("Deferred with reference policy is trivially copyable") {
+        using target_type = decltype(ufmt::defer("x: ", 1, std::string{"y"}, 2.0));
+        REQUIRE(std::is_trivially_copyable_v<target_type>);
+    }
+
+
+    SCENARIO("Render short string copied inline") {
+        std::string s{"short"};
+        auto const target = ufmt::defer("s: ", s);
+        s = "changed";
+        ufmt::text rendered;
+        target.render(rendered);
+        REQUIRE_EQ(rendered.string(), "s: short");
+    }
+
+
+    SCENARIO("Render long string by reference and by copy") {
+        std::string s(64, 'a');
+        auto const by_reference = ufmt::defer(s);
+        auto const by_copy = ufmt::defer_copy(s);
+        s.assign(64, 'b');
+        ufmt::text rendered;
+        by_reference.render(rendered);
+        REQUIRE_EQ(rendered.string(), std::string(64, 'b'));
+        rendered.clear();
+        by_copy.render(rendered);
+        REQUIRE_EQ(rendered.string(), std::string(64, 'a'));
+    }
+
+
+    SCENARIO("Render formatters") {
+        using ufmt::dquoted;
+        using ufmt::fixed;
+        using ufmt::left;
+        using ufmt::precised;
+        using ufmt::right;
+        using ufmt::textize;
+        std::string const s{"qwerty"};
+        auto const target = ufmt::defer(left(1, 4), right(s, 8), ufmt::quoted(s), dquoted(7),
+                                        fixed(12, 4), precised(1.0, 3), textize(s), textize(7));
+        ufmt::text rendered;
+        target.render(rendered);
+        REQUIRE_EQ(rendered.string(),
+                   ufmt::text::of(left(1, 4), right(s, 8), ufmt::quoted(s), dquoted(7),
+                                  fixed(12, 4), precised(1.0, 3), textize(s), textize(7)));
+    }
+
+
+    SCENARIO("Render type-erased message") {
+        auto const message = ufmt::deferred_message::of("value: ", 127562, ", ", 0.5);
+        REQUIRE_EQ(sizeof(message), 256);
+        auto const copied = message;
+        ufmt::text rendered;
+        copied.render(rendered);
+        REQUIRE_EQ(rendered.string(), "value: 127562, 0.5");
+    }
+}
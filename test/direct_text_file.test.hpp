@@ -0,0 +1,44 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include "doctest.h"
+
+#include <ufmt/direct_text_file.hpp>
+
+
+TEST_SUITE("direct_text_file") {
+
+
+    SCENARIO("Whole blocks and the final tail are written in order") {
+        auto const path = std::string{"ufmt-direct_text_file.test.log"};
+        std::error_code ec;
+        std::string expected;
+        {
+            auto file = ufmt::direct_text_file::create_always(path, ec,
+                                                              {.buffer_size = 4096, .buffers = 3});
+            REQUIRE(file);
+            for(auto i = 0; i != 10000; ++i) {
+                file->print("line ", i, ", value ", -127562.127562);
+                expected += ufmt::text::of("line ", i, ", value ", -127562.127562, '\n');
+            }
+            file->write(std::string(10000, '*'));
+            expected += std::string(10000, '*');
+            auto moved = std::move(*file);
+            moved.print("tail");
+            expected += "tail\n";
+            moved.close();
+            REQUIRE_FALSE(moved.error());
+        }
+        std::ifstream in{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{in}, {}};
+        REQUIRE_EQ(content, expected);
+        std::remove(path.data());
+    }
+
+}
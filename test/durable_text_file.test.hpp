@@ -0,0 +1,70 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/durable_text_file.hpp>
+
+
+TEST_SUITE("durable_text_file") {
+
+
+    SCENARIO("Records are numbered and become durable in order") {
+        auto const path = std::string{"ufmt-durable_text_file.test.log"};
+        std::error_code ec;
+        {
+            auto file = ufmt::durable_text_file::create_always(path, ec);
+            REQUIRE(file);
+            REQUIRE_EQ(file->print("first"), 1);
+            REQUIRE_EQ(file->write("second\n"), 2);
+            auto const third = file->print("third ", 3);
+            REQUIRE_EQ(third, 3);
+            REQUIRE(file->wait_durable(third));
+            REQUIRE_GE(file->durable(), 3);
+            REQUIRE_FALSE(file->error());
+
+            std::ifstream in{path, std::ios::binary};
+            std::string const content{std::istreambuf_iterator<char>{in}, {}};
+            REQUIRE_EQ(content, "first\nsecond\nthird 3\n");
+        }
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Concurrent waiters share commits") {
+        auto const path = std::string{"ufmt-durable_text_file-threads.test.log"};
+        std::error_code ec;
+        std::uint64_t commits;
+        {
+            auto file = ufmt::durable_text_file::create_always(path, ec);
+            REQUIRE(file);
+            std::vector<std::thread> writers;
+            for(auto t = 0; t != 4; ++t)
+                writers.emplace_back([&file, t] {
+                    for(auto i = 0; i != 50; ++i)
+                        file->print_durable(t, ':', i);
+                });
+            for(auto& writer: writers)
+                writer.join();
+            REQUIRE_EQ(file->durable(), 200);
+            commits = file->commits();
+        }
+        REQUIRE_LE(commits, 200);
+        std::ifstream in{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{in}, {}};
+        std::size_t lines = 0;
+        for(auto c: content)
+            lines += c == '\n' ? 1 : 0;
+        REQUIRE_EQ(lines, 200);
+        std::remove(path.data());
+    }
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/flight_recorder.hpp>
+
+
+TEST_SUITE("flight_recorder") {
+
+
+    SCENARIO("Records are read back in order before the ring wraps") {
+        auto const name = std::string{"ufmt-flight_recorder.test"};
+        std::error_code ec;
+        auto recorder = ufmt::flight_recorder::create(name, ec, {.capacity = 4096});
+        REQUIRE(recorder);
+        REQUIRE_EQ(recorder->capacity(), 4096);
+        recorder->print("first ", 1);
+        recorder->print("second ", 2.5);
+
+        std::vector<std::uint64_t> sequences;
+        std::string content;
+        REQUIRE(ufmt::read_flight_recorder(name, ec, [&](std::uint64_t sequence, std::string_view record) {
+            sequences.push_back(sequence);
+            content += record;
+        }));
+        REQUIRE_EQ(sequences, std::vector<std::uint64_t>{1, 2});
+        REQUIRE_EQ(content, "first 1\nsecond 2.5\n");
+        REQUIRE(ufmt::flight_recorder::remove(name, ec));
+    }
+
+
+    SCENARIO("Only the most recent records survive after wrapping") {
+        auto const name = std::string{"ufmt-flight_recorder-wrap.test"};
+        std::error_code ec;
+        {
+            auto recorder = ufmt::flight_recorder::create(name, ec, {.capacity = 4096});
+            REQUIRE(recorder);
+            for(auto i = 1; i <= 1000; ++i)
+                recorder->print("line ", i, ' ', -127562.127562);
+            std::string const big(5000, '*');
+            recorder->write(big, ec);
+            recorder->print("last");
+            REQUIRE_EQ(recorder->sequence(), 1002);
+        }
+
+        std::vector<std::uint64_t> sequences;
+        std::vector<std::string> records;
+        REQUIRE(ufmt::read_flight_recorder(name, ec, [&](std::uint64_t sequence, std::string_view record) {
+            sequences.push_back(sequence);
+            records.emplace_back(record);
+        }));
+        REQUIRE_GT(records.size(), 10);
+        REQUIRE_EQ(sequences.back(), 1002);
+        REQUIRE_EQ(records.back(), "last\n");
+        REQUIRE_EQ(records[records.size() - 2], std::string(1024 - 24, '*'));
+        for(auto i = 0u; i + 2 < records.size(); ++i) {
+            REQUIRE_EQ(sequences[i] + 1, sequences[i + 1]);
+            REQUIRE_EQ(records[i], ufmt::text::of("line ", sequences[i], ' ', -127562.127562, '\n'));
+        }
+        REQUIRE(ufmt::flight_recorder::remove(name, ec));
+        REQUIRE_FALSE(ufmt::read_flight_recorder(name, ec, [](std::uint64_t, std::string_view) { }));
+        REQUIRE_EQ(ec, std::errc::no_such_file_or_directory);
+    }
+
+}
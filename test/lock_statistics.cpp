@@ -0,0 +1,8 @@
+// Spinlock tests again with statistics compiled in. UFMT_LOCK_STATISTICS
+// changes the layout of the lock, so it is a target of its own
+#define UFMT_LOCK_STATISTICS
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+
+#include "spinlock.test.hpp"
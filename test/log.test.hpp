@@ -0,0 +1,34 @@
+#pragma once
+
+
+#include "doctest.h"
+
+#include <ufmt/log.hpp>
+
+
+TEST_SUITE("log") {
+
+
+    SCENARIO("Runtime level filters lower levels") {
+        auto const saved = ufmt::get_level();
+        ufmt::set_level(ufmt::level::info);
+        REQUIRE_FALSE(ufmt::enabled(ufmt::level::debug));
+        REQUIRE(ufmt::enabled(ufmt::level::info));
+        REQUIRE(ufmt::enabled(ufmt::level::warn));
+        ufmt::set_level(ufmt::level::off);
+        REQUIRE_FALSE(ufmt::enabled(ufmt::level::warn));
+        ufmt::set_level(saved);
+    }
+
+
+    SCENARIO("Disabled macro does not evaluate arguments") {
+        auto const saved = ufmt::get_level();
+        ufmt::set_level(ufmt::level::off);
+        auto evaluated = 0;
+        UFMT_DEBUG("value: ", ++evaluated);
+        UFMT_INFO("value: ", ++evaluated);
+        UFMT_WARN("value: ", ++evaluated);
+        REQUIRE_EQ(evaluated, 0);
+        ufmt::set_level(saved);
+    }
+}
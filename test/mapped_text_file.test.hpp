@@ -0,0 +1,109 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/mapped_text_file.hpp>
+
+
+namespace {
+
+    std::string mapped_content(std::string const& path) {
+        std::ifstream in{path, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{in}, {}};
+    }
+
+}
+
+
+TEST_SUITE("mapped_text_file") {
+
+
+    SCENARIO("Closed file is truncated to the printed text") {
+        auto const path = std::string{"ufmt-mapped_text_file.test.log"};
+        std::error_code ec;
+        std::string expected;
+        {
+            auto file = ufmt::mapped_text_file::create_always(path, ec, {.window_size = 8192});
+            REQUIRE(file);
+            for(auto i = 0; i != 3000; ++i) {
+                file->print("line ", i, ", value ", -127562.127562);
+                expected += ufmt::text::of("line ", i, ", value ", -127562.127562, '\n');
+            }
+            file->print(std::string(20000, '*'));
+            expected += std::string(20000, '*') + '\n';
+            REQUIRE(file->flush());
+            auto moved = std::move(*file);
+            moved.print("last");
+            expected += "last\n";
+            REQUIRE_EQ(moved.size(), expected.size());
+            REQUIRE_FALSE(moved.error());
+        }
+        REQUIRE_EQ(mapped_content(path), expected);
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Reopened file drops preallocated space left by a crash") {
+        auto const path = std::string{"ufmt-mapped_text_file-recover.test.log"};
+        std::remove(path.data());
+        std::error_code ec;
+        {
+            auto file = ufmt::mapped_text_file::create_always(path, ec);
+            REQUIRE(file);
+            file->print("before crash");
+        }
+        std::string const zeros(3, '\0');
+        auto const child = ::fork();
+        REQUIRE_NE(child, -1);
+        if(child == 0) {
+            auto file = ufmt::mapped_text_file::open_always_to_append(path, ec, {.window_size = 8192});
+            file->print("zeros ", zeros, " inside");
+            file->print(zeros);
+            ::_exit(0);
+        }
+        int status = 0;
+        REQUIRE_EQ(::waitpid(child, &status, 0), child);
+        auto const crashed = mapped_content(path);
+        REQUIRE_GE(crashed.size(), 8192);
+
+        auto const printed = "before crash\nzeros " + zeros + " inside\n" + zeros + '\n';
+        {
+            auto file = ufmt::mapped_text_file::open_always_to_append(path, ec);
+            REQUIRE(file);
+            REQUIRE_EQ(file->size(), printed.size());
+            file->print("after ", 1);
+        }
+        REQUIRE_EQ(mapped_content(path), printed + "after 1\n");
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Closed file keeps its trailing zeros") {
+        auto const path = std::string{"ufmt-mapped_text_file-zeros.test.log"};
+        std::string const existing = "written elsewhere\n" + std::string(100, '\0');
+        {
+            std::ofstream out{path, std::ios::binary};
+            out << existing;
+        }
+        std::error_code ec;
+        {
+            auto file = ufmt::mapped_text_file::open_always_to_append(path, ec);
+            REQUIRE(file);
+            REQUIRE_EQ(file->size(), existing.size());
+            file->print("appended");
+        }
+        REQUIRE_EQ(mapped_content(path), existing + "appended\n");
+        std::remove(path.data());
+    }
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/memfd_sink.hpp>
+
+
+namespace {
+
+    // Passes fd the way memfd_sink::send does, claiming size bytes
+    bool send_descriptor(int socket, int fd, std::uint64_t size) {
+        ::iovec payload{&size, sizeof(size)};
+        alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        ::msghdr message{};
+        message.msg_iov = &payload;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        auto* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(header), &fd, sizeof(fd));
+        return ::sendmsg(socket, &message, MSG_NOSIGNAL) != -1;
+    }
+
+} // namespace
+
+
+TEST_SUITE("memfd_sink") {
+
+
+    SCENARIO("Sealed report is mapped by the receiving side") {
+        std::error_code ec;
+        auto report = ufmt::memfd_sink::create("ufmt-report", ec, 4096);
+        REQUIRE(report);
+        std::string expected;
+        for(auto i = 0; i != 20000; ++i) {
+            REQUIRE(report->print("row ", i, ", value ", -127562.127562));
+            expected += ufmt::text::of("row ", i, ", value ", -127562.127562, '\n');
+        }
+        REQUIRE(report->write("end\n", ec));
+        expected += "end\n";
+        REQUIRE_EQ(report->view(), expected);
+
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+        REQUIRE(report->send(pair[0], ec));
+        REQUIRE(report->sealed());
+        REQUIRE_FALSE(report->print("late"));
+        REQUIRE_FALSE(report->write("late", ec));
+        REQUIRE_EQ(report->size(), expected.size());
+
+        auto received = ufmt::memfd_view::receive(pair[1], ec);
+        REQUIRE(received);
+        REQUIRE_EQ(received->view(), expected);
+        REQUIRE_EQ(::mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, received->fd(), 0),
+                   MAP_FAILED);
+        REQUIRE_EQ(::ftruncate(received->fd(), 0), -1);
+        ::close(pair[0]);
+        ::close(pair[1]);
+    }
+
+
+    SCENARIO("Failed seal leaves the report usable") {
+        std::error_code ec;
+        auto report = ufmt::memfd_sink::create("ufmt-report", ec, 4096);
+        REQUIRE(report);
+        REQUIRE(report->print("first"));
+        // sealing the seals makes F_ADD_SEALS fail after the mapping is gone
+        REQUIRE_NE(::fcntl(report->fd(), F_ADD_SEALS, F_SEAL_SEAL), -1);
+        REQUIRE_FALSE(report->seal(ec));
+        REQUIRE_EQ(ec, std::errc::operation_not_permitted);
+        REQUIRE_FALSE(report->sealed());
+        REQUIRE_EQ(report->view(), "first\n");
+        REQUIRE(report->print("second"));
+        REQUIRE_EQ(report->view(), "first\nsecond\n");
+
+        // the memfd can't grow back either, the report is gone for good
+        auto broken = ufmt::memfd_sink::create("ufmt-report", ec, 4096);
+        REQUIRE(broken);
+        REQUIRE(broken->print("first"));
+        REQUIRE_NE(::fcntl(broken->fd(), F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SEAL), -1);
+        ec.clear();
+        REQUIRE_FALSE(broken->seal(ec));
+        REQUIRE_FALSE(broken->sealed());
+        REQUIRE(broken->view().empty());
+        REQUIRE_EQ(broken->size(), 0);
+        REQUIRE_FALSE(broken->print("second"));
+        ec.clear();
+        REQUIRE_FALSE(broken->write("third", ec));
+        REQUIRE(ec);
+        REQUIRE(broken->view().empty());
+    }
+
+
+    SCENARIO("Unsealed descriptors are rejected") {
+        std::error_code ec;
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+
+        auto const unsealed = ::memfd_create("ufmt-unsealed", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        REQUIRE_NE(unsealed, -1);
+        REQUIRE_EQ(::ftruncate(unsealed, 4096), 0);
+        REQUIRE(send_descriptor(pair[0], unsealed, 4096));
+        REQUIRE_FALSE(ufmt::memfd_view::receive(pair[1], ec));
+        REQUIRE_EQ(ec, std::errc::bad_message);
+        ::close(unsealed);
+
+        auto const path = std::string{"ufmt-unsealed.test.txt"};
+        auto const regular = ::open(path.data(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+        REQUIRE_NE(regular, -1);
+        REQUIRE_EQ(::write(regular, "report\n", 7), 7);
+        REQUIRE(send_descriptor(pair[0], regular, 7));
+        ec.clear();
+        REQUIRE_FALSE(ufmt::memfd_view::receive(pair[1], ec));
+        REQUIRE_EQ(ec, std::errc::bad_message);
+        ::close(regular);
+        ::unlink(path.data());
+
+        ::close(pair[0]);
+        ec.clear();
+        REQUIRE_FALSE(ufmt::memfd_view::receive(pair[1], ec));
+        REQUIRE_EQ(ec, std::errc::bad_message);
+        ::close(pair[1]);
+    }
+
+}
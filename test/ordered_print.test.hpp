@@ -0,0 +1,77 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/ordered_print.hpp>
+
+
+TEST_SUITE("ordered_print") {
+
+
+    SCENARIO("Lines of every thread keep their order") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        {
+            ufmt::ordered_printer target{{.capacity = 64, .fd = fileno(file)}};
+            std::vector<std::thread> producers;
+            for(auto t = 0; t != 4; ++t)
+                producers.emplace_back([&target, t] {
+                    for(auto i = 0; i != 500; ++i)
+                        while(!target.print(t, ' ', i, " of a line longer than one cache line slot"))
+                            std::this_thread::yield();
+                });
+            for(auto& producer: producers)
+                producer.join();
+        }
+        std::rewind(file);
+        int next[4] = {0, 0, 0, 0};
+        auto lines = 0;
+        char line[128];
+        while(std::fgets(line, sizeof(line), file)) {
+            int t, i;
+            REQUIRE_EQ(std::sscanf(line, "%d %d", &t, &i), 2);
+            REQUIRE_EQ(i, next[t]++);
+            ++lines;
+        }
+        REQUIRE_EQ(lines, 2000);
+        std::fclose(file);
+    }
+
+
+    SCENARIO("Queues are kept per printer and retired with their thread") {
+        auto* first_file = std::tmpfile();
+        auto* second_file = std::tmpfile();
+        {
+            ufmt::ordered_printer first{{.capacity = 64, .fd = fileno(first_file)}};
+            ufmt::ordered_printer second{{.capacity = 64, .fd = fileno(second_file)}};
+            std::thread producer{[&] {
+                for(auto i = 0; i != 1000; ++i) {
+                    while(!first.print("first ", i))
+                        std::this_thread::yield();
+                    while(!second.print("second ", i))
+                        std::this_thread::yield();
+                }
+                REQUIRE_EQ(first.queues(), 1);
+                REQUIRE_EQ(second.queues(), 1);
+            }};
+            producer.join();
+            for(auto i = 0; i != 1000 && first.queues() + second.queues() != 0; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            REQUIRE_EQ(first.queues(), 0);
+            REQUIRE_EQ(second.queues(), 0);
+            first.print("after");
+            REQUIRE_EQ(first.queues(), 1);
+        }
+        REQUIRE_GT(std::ftell(first_file), 0);
+        REQUIRE_GT(std::ftell(second_file), 0);
+        std::fclose(first_file);
+        std::fclose(second_file);
+    }
+}
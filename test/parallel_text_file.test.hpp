@@ -0,0 +1,83 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/parallel_text_file.hpp>
+
+
+TEST_SUITE("parallel_text_file") {
+
+
+    SCENARIO("Watermark stops at the oldest uncommitted range") {
+        ufmt::detail::watermark offsets{100};
+        std::promise<void> reserved, release;
+        std::uint64_t first = 0;
+        std::thread holder{[&] {
+            first = offsets.reserve(10);
+            reserved.set_value();
+            release.get_future().wait();
+            offsets.commit();
+        }};
+        reserved.get_future().wait();
+        REQUIRE_EQ(first, 100);
+        REQUIRE_EQ(offsets.reserve(5), 110);
+        offsets.commit();
+        REQUIRE_EQ(offsets.reserved(), 115);
+        REQUIRE_EQ(offsets.committed(), 100);
+        release.set_value();
+        holder.join();
+        REQUIRE_EQ(offsets.committed(), 115);
+        REQUIRE_EQ(offsets.threads(), 1);
+
+        offsets.reset(0);
+        REQUIRE_EQ(offsets.reserve(7), 0);
+        offsets.commit();
+        REQUIRE_EQ(offsets.committed(), 7);
+        REQUIRE_EQ(offsets.threads(), 1);
+    }
+
+
+    SCENARIO("Records of several threads stay whole") {
+        auto const path = std::string{"ufmt-parallel_text_file.test.log"};
+        std::error_code ec;
+        {
+            auto file = ufmt::parallel_text_file::create_always(path, ec);
+            REQUIRE(file);
+            std::vector<std::thread> writers;
+            for(auto t = 0; t != 4; ++t)
+                writers.emplace_back([&file, t] {
+                    for(auto i = 0; i != 1000; ++i)
+                        file->print("thread ", t, ", record ", i);
+                });
+            for(auto& writer: writers)
+                writer.join();
+            REQUIRE_EQ(file->committed(), file->reserved());
+        }
+        std::ifstream in{path, std::ios::binary};
+        std::set<std::string> records;
+        for(std::string line; std::getline(in, line);)
+            records.insert(line);
+        REQUIRE_EQ(records.size(), 4000);
+        REQUIRE(records.count("thread 3, record 999") == 1);
+
+        auto appended = ufmt::parallel_text_file::open_always_to_append(path, ec);
+        REQUIRE(appended);
+        auto const size = appended->reserved();
+        appended->print("last");
+        REQUIRE_EQ(appended->committed(), size + 5);
+        appended->close();
+        std::remove(path.data());
+    }
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/pipe_printer.hpp>
+
+
+TEST_SUITE("pipe_printer") {
+
+
+    SCENARIO("Lines moved into a pipe arrive unchanged") {
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        std::string received;
+        std::thread reader{[&] {
+            char chunk[4096];
+            for(auto n = ::read(fds[0], chunk, sizeof(chunk)); n > 0;
+                n = ::read(fds[0], chunk, sizeof(chunk)))
+                received.append(chunk, std::size_t(n));
+        }};
+
+        std::string expected;
+        {
+            ufmt::pipe_printer printer{{.fd = fds[1], .buffer_size = 8192, .buffers = 2}};
+            REQUIRE(printer.spliced());
+            for(auto i = 0; i != 50000; ++i) {
+                printer.print("line ", i, ' ', -127562.127562);
+                expected += ufmt::text::of("line ", i, ' ', -127562.127562, '\n');
+            }
+            std::string const big(20000, '*');
+            printer.print(big);
+            expected += big + '\n';
+            printer.print("last");
+            expected += "last\n";
+            printer.flush();
+            REQUIRE_FALSE(printer.error());
+        }
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+        REQUIRE_EQ(received, expected);
+    }
+
+
+    SCENARIO("Bytes of another writer do not release gifted pages") {
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        std::string const foreign(20000, '#');
+        REQUIRE_EQ(::write(fds[1], foreign.data(), foreign.size()), ssize_t(foreign.size()));
+        std::string received;
+        std::thread reader{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            char chunk[4096];
+            for(auto n = ::read(fds[0], chunk, sizeof(chunk)); n > 0;
+                n = ::read(fds[0], chunk, sizeof(chunk)))
+                received.append(chunk, std::size_t(n));
+        }};
+
+        std::string expected = foreign;
+        {
+            ufmt::pipe_printer printer{{.fd = fds[1], .buffer_size = 4096, .buffers = 2}};
+            REQUIRE(printer.spliced());
+            for(auto c: {'A', 'B', 'C'}) {
+                std::string const page(4095, c);
+                printer.print(page);
+                expected += page + '\n';
+            }
+            printer.flush();
+            REQUIRE_FALSE(printer.error());
+        }
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+        REQUIRE_EQ(received, expected);
+    }
+
+
+    SCENARIO("Not a pipe falls back to write") {
+        auto const path = std::string{"ufmt-pipe_printer.test.log"};
+        auto const fd = ::open(path.data(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        REQUIRE_NE(fd, -1);
+        std::string expected;
+        {
+            ufmt::pipe_printer printer{{.fd = fd, .buffer_size = 4096}};
+            REQUIRE_FALSE(printer.spliced());
+            for(auto i = 0; i != 2000; ++i) {
+                printer.print("line ", i);
+                expected += ufmt::text::of("line ", i, '\n');
+            }
+        }
+        ::close(fd);
+        std::ifstream in{path, std::ios::binary};
+        REQUIRE_EQ(std::string{std::istreambuf_iterator<char>{in}, {}}, expected);
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Printing does not wait for a reader that went away") {
+        auto const previous = std::signal(SIGPIPE, SIG_IGN);
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        std::thread reader{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds{50});
+            ::close(fds[0]);
+        }};
+        {
+            ufmt::pipe_printer printer{{.fd = fds[1], .buffer_size = 8192, .buffers = 2}};
+            for(auto i = 0; i != 20000; ++i)
+                printer.print("line ", i, ' ', -127562.127562);
+            printer.flush();
+            REQUIRE_EQ(printer.error(), std::errc::broken_pipe);
+        }
+        reader.join();
+        ::close(fds[1]);
+        std::signal(SIGPIPE, previous);
+    }
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/print.hpp>
+
+
+namespace {
+
+    constexpr auto print_threads = 4;
+    constexpr auto lines_per_thread = 300;
+
+
+    // Short lines and lines longer than PIPE_BUF from every thread
+    std::vector<std::string> printed_lines() {
+        std::vector<std::string> lines;
+        for(auto t = 0; t != print_threads; ++t)
+            for(auto i = 0; i != lines_per_thread; ++i)
+                lines.push_back(i % 3 == 0
+                    ? ufmt::text::of("long ", t, ' ', i, ' ', std::string(10000, char('a' + t)))
+                    : ufmt::text::of("short ", t, ' ', i));
+        return lines;
+    }
+
+
+    // Prints printed_lines() from several threads of a child whose stdout is fd
+    std::vector<std::string> print_in_child(int fd, int read_end) {
+        std::fflush(nullptr);
+        auto const child = ::fork();
+        REQUIRE_NE(child, -1);
+        if(child == 0) {
+            ::dup2(fd, 1);
+            if(read_end != -1)
+                ::close(read_end);
+            ufmt::output_redirected();
+            auto const lines = printed_lines();
+            std::vector<std::thread> threads;
+            for(auto t = 0; t != print_threads; ++t)
+                threads.emplace_back([&lines, t] {
+                    for(auto i = 0; i != lines_per_thread; ++i)
+                        ufmt::print(lines[std::size_t(t * lines_per_thread + i)]);
+                });
+            for(auto& thread: threads)
+                thread.join();
+            ::_exit(0);
+        }
+
+        std::string received;
+        if(read_end != -1) {
+            ::close(fd);
+            char chunk[4096];
+            for(auto n = ::read(read_end, chunk, sizeof(chunk)); n > 0;
+                n = ::read(read_end, chunk, sizeof(chunk)))
+                received.append(chunk, std::size_t(n));
+            ::close(read_end);
+        }
+        int status = 0;
+        REQUIRE_EQ(::waitpid(child, &status, 0), child);
+        REQUIRE(WIFEXITED(status));
+        if(read_end == -1) {
+            char chunk[4096];
+            ::lseek(fd, 0, SEEK_SET);
+            for(auto n = ::read(fd, chunk, sizeof(chunk)); n > 0;
+                n = ::read(fd, chunk, sizeof(chunk)))
+                received.append(chunk, std::size_t(n));
+        }
+
+        std::vector<std::string> lines;
+        for(std::size_t begin = 0, end; begin < received.size(); begin = end + 1) {
+            end = received.find('\n', begin);
+            if(end == std::string::npos)
+                end = received.size();
+            lines.emplace_back(received, begin, end - begin);
+        }
+        return lines;
+    }
+
+} // namespace
+
+
+TEST_SUITE("print") {
+
+
+    SCENARIO("Lines of several threads are not mixed") {
+        auto expected = printed_lines();
+        std::sort(expected.begin(), expected.end());
+
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        auto to_file = print_in_child(fileno(file), -1);
+        std::fclose(file);
+        std::sort(to_file.begin(), to_file.end());
+        REQUIRE(to_file == expected);
+
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        auto to_pipe = print_in_child(fds[1], fds[0]);
+        std::sort(to_pipe.begin(), to_pipe.end());
+        REQUIRE(to_pipe == expected);
+    }
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/printer.hpp>
+
+
+namespace {
+
+    // Everything readable within the timeout
+    std::string read_pipe(int fd, std::chrono::milliseconds timeout) {
+        std::string received;
+        char chunk[4096];
+        ::pollfd p{fd, POLLIN, 0};
+        while(::poll(&p, 1, int(timeout.count())) == 1) {
+            auto const n = ::read(fd, chunk, sizeof(chunk));
+            if(n <= 0)
+                break;
+            received.append(chunk, std::size_t(n));
+            timeout = std::chrono::milliseconds{0};
+        }
+        return received;
+    }
+
+
+    std::atomic<int> interrupts{0};
+
+    extern "C" inline void count_interrupt(int) { interrupts.fetch_add(1); }
+
+} // namespace
+
+
+TEST_SUITE("printer") {
+
+
+    SCENARIO("Lines are written once the buffer is full") {
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        {
+            ufmt::printer target{{.fd = fds[1], .capacity = 64,
+                                  .max_delay = std::chrono::hours{1}}};
+            target.print("first line");
+            REQUIRE(read_pipe(fds[0], std::chrono::milliseconds{0}).empty());
+            std::string expected = "first line\n";
+            auto i = 0;
+            for(; expected.size() < 64; ++i) {
+                REQUIRE_EQ(target.flushes(), 0);
+                target.print("line ", i, " of the batch");
+                expected += ufmt::text::of("line ", i, " of the batch\n");
+            }
+            REQUIRE_EQ(target.flushes(), 1);
+            REQUIRE_EQ(target.lines(), i + 1);
+            REQUIRE_EQ(read_pipe(fds[0], std::chrono::milliseconds{0}), expected);
+            target.print("rest");
+            REQUIRE(read_pipe(fds[0], std::chrono::milliseconds{0}).empty());
+        }
+        REQUIRE_EQ(read_pipe(fds[0], std::chrono::milliseconds{0}), "rest\n");
+        ::close(fds[1]);
+        ::close(fds[0]);
+    }
+
+
+    SCENARIO("Stale lines are written by the next print or the timer") {
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        {
+            ufmt::printer target{{.fd = fds[1], .max_delay = std::chrono::milliseconds{2}}};
+            target.print("old");
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            target.print("new");
+            REQUIRE_EQ(read_pipe(fds[0], std::chrono::milliseconds{0}), "old\nnew\n");
+        }
+        {
+            ufmt::printer target{{.fd = fds[1], .max_delay = std::chrono::milliseconds{5},
+                                  .background_flush = true}};
+            target.print("idle");
+            REQUIRE_EQ(read_pipe(fds[0], std::chrono::seconds{2}), "idle\n");
+            REQUIRE_EQ(target.flushes(), 1);
+        }
+        ::close(fds[1]);
+        ::close(fds[0]);
+    }
+
+
+    SCENARIO("Interrupted and partial writes lose nothing") {
+        struct ::sigaction action{}, previous{};
+        action.sa_handler = count_interrupt;
+        ::sigemptyset(&action.sa_mask);
+        action.sa_flags = 0;   // no SA_RESTART, blocked writes return early
+        REQUIRE_EQ(::sigaction(SIGUSR1, &action, &previous), 0);
+
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        std::string received;
+        std::thread reader{[&] {
+            char chunk[512];
+            for(auto n = ::read(fds[0], chunk, sizeof(chunk)); n > 0;
+                n = ::read(fds[0], chunk, sizeof(chunk))) {
+                received.append(chunk, std::size_t(n));
+                std::this_thread::sleep_for(std::chrono::microseconds{20});
+            }
+        }};
+        std::atomic<bool> done{false};
+        auto const writer = ::pthread_self();
+        std::thread signaler{[&] {
+            while(!done.load()) {
+                ::pthread_kill(writer, SIGUSR1);
+                std::this_thread::sleep_for(std::chrono::microseconds{200});
+            }
+        }};
+
+        std::string expected;
+        {
+            ufmt::printer target{{.fd = fds[1], .capacity = 1 << 20,
+                                  .max_delay = std::chrono::hours{1}}};
+            for(auto i = 0; i != 20000; ++i) {
+                target.print("line ", i, ' ', -127562.127562);
+                expected += ufmt::text::of("line ", i, ' ', -127562.127562, '\n');
+            }
+            target.flush();
+            REQUIRE_FALSE(target.error());
+        }
+        done.store(true);
+        signaler.join();
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+        ::sigaction(SIGUSR1, &previous, nullptr);
+        REQUIRE_GT(interrupts.load(), 0);
+        REQUIRE_EQ(received, expected);
+    }
+
+
+    SCENARIO("Global printer is flushed at exit") {
+        int fds[2];
+        REQUIRE_EQ(::pipe(fds), 0);
+        std::fflush(nullptr);
+        auto const child = ::fork();
+        REQUIRE_NE(child, -1);
+        if(child == 0) {
+            ::dup2(fds[1], 1);
+            ::close(fds[0]);
+            ufmt::global_printer().configure({.max_delay = std::chrono::hours{1}});
+            ufmt::global_printer().print("printed before exit ", 42);
+            std::exit(0);
+        }
+        ::close(fds[1]);
+        std::string received;
+        char chunk[256];
+        for(auto n = ::read(fds[0], chunk, sizeof(chunk)); n > 0;
+            n = ::read(fds[0], chunk, sizeof(chunk)))
+            received.append(chunk, std::size_t(n));
+        ::close(fds[0]);
+        int status = 0;
+        REQUIRE_EQ(::waitpid(child, &status, 0), child);
+        REQUIRE_EQ(received, "printed before exit 42\n");
+    }
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+
+#include <chrono>
+
+#include "doctest.h"
+
+#include <ufmt/rate_limit.hpp>
+
+
+TEST_SUITE("rate_limit") {
+
+
+    SCENARIO("Every n limiter admits the first of every n lines") {
+        ufmt::every_n_limiter target{3};
+        REQUIRE(target.admit());
+        REQUIRE_FALSE(target.admit());
+        REQUIRE_FALSE(target.admit());
+        REQUIRE(target.admit());
+        REQUIRE_EQ(target.take_suppressed(), 2);
+        REQUIRE_EQ(target.take_suppressed(), 0);
+    }
+
+
+    SCENARIO("Rate limiter admits a burst per period") {
+        ufmt::rate_limiter target{std::chrono::hours{1}, 2};
+        REQUIRE(target.admit());
+        REQUIRE(target.admit());
+        REQUIRE_FALSE(target.admit());
+        REQUIRE_FALSE(target.admit());
+        REQUIRE_EQ(target.take_suppressed(), 2);
+    }
+
+
+    SCENARIO("Sampler admits nothing or everything at the extremes") {
+        ufmt::sampler never{0.};
+        ufmt::sampler always{1.};
+        for(auto i = 0; i != 100; ++i) {
+            REQUIRE_FALSE(never.admit());
+            REQUIRE(always.admit());
+        }
+        REQUIRE_EQ(never.take_suppressed(), 100);
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/rotating_text_file.hpp>
+
+
+namespace {
+
+    std::string rotated_content(std::string const& path) {
+        std::string content;
+        for(auto index: ufmt::detail::rotate::existing(path)) {
+            std::ifstream in{ufmt::detail::rotate::numbered(path, index), std::ios::binary};
+            content.append(std::istreambuf_iterator<char>{in}, {});
+        }
+        return content;
+    }
+
+
+    void remove_rotated(std::string const& path) {
+        for(auto index: ufmt::detail::rotate::existing(path))
+            std::filesystem::remove(ufmt::detail::rotate::numbered(path, index));
+    }
+
+}
+
+
+TEST_SUITE("rotating_text_file") {
+
+
+    SCENARIO("Files rotate by size and only the last ones are kept") {
+        auto const path = std::string{"ufmt-rotating.test.log"};
+        remove_rotated(path);
+        std::error_code ec;
+        std::string expected;
+        {
+            auto file = ufmt::rotating_text_file::open(path, ec, {.max_size = 1000, .keep = 3});
+            REQUIRE(file);
+            REQUIRE_EQ(file->current_path(), path + ".000001");
+            for(auto i = 0; i != 2000; ++i) {
+                REQUIRE(file->print("line ", i));
+                expected += ufmt::text::of("line ", i, '\n');
+                if(i % 50 == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+            REQUIRE_GT(file->rotations(), 2);
+        }
+        auto const indices = ufmt::detail::rotate::existing(path);
+        REQUIRE_LE(indices.size(), 3);
+        auto const content = rotated_content(path);
+        REQUIRE_FALSE(content.empty());
+        REQUIRE_EQ(expected.substr(expected.size() - content.size()), content);
+        REQUIRE_EQ(content.substr(0, 5), "line ");
+
+        auto reopened = ufmt::rotating_text_file::open(path, ec);
+        REQUIRE(reopened);
+        REQUIRE_EQ(reopened->current_path(),
+                   ufmt::detail::rotate::numbered(path, indices.back() + 1));
+        reopened->close();
+        remove_rotated(path);
+    }
+
+
+    SCENARIO("Files rotate by age") {
+        auto const path = std::string{"ufmt-rotating-age.test.log"};
+        remove_rotated(path);
+        std::error_code ec;
+        {
+            auto file = ufmt::rotating_text_file::open(
+                path, ec, {.max_age = std::chrono::milliseconds{20}, .keep = 10});
+            REQUIRE(file);
+            file->print("first");
+            for(auto i = 0; i != 200 && file->rotations() == 0; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            REQUIRE_EQ(file->rotations(), 1);
+            file->print("second");
+        }
+        REQUIRE_EQ(ufmt::detail::rotate::existing(path).size(), 2);
+        REQUIRE_EQ(rotated_content(path), "first\nsecond\n");
+        remove_rotated(path);
+    }
+
+
+    SCENARIO("Several threads write whole lines across rotations") {
+        auto const path = std::string{"ufmt-rotating-threads.test.log"};
+        remove_rotated(path);
+        std::error_code ec;
+        {
+            auto file = ufmt::rotating_text_file::open(path, ec, {.max_size = 4096, .keep = 0});
+            REQUIRE(file);
+            std::vector<std::thread> writers;
+            for(auto t = 0; t != 4; ++t)
+                writers.emplace_back([&file, t] {
+                    for(auto i = 0; i != 2000; ++i)
+                        file->print(t, ':', i);
+                });
+            for(auto& writer: writers)
+                writer.join();
+        }
+        auto const content = rotated_content(path);
+        std::size_t lines = 0;
+        for(auto c: content)
+            lines += c == '\n' ? 1 : 0;
+        REQUIRE_EQ(lines, 8000);
+        remove_rotated(path);
+    }
+
+
+    SCENARIO("Failure to open the next file is reported") {
+        auto const directory = std::filesystem::path{"ufmt-rotating-error.test.d"};
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directory(directory);
+        std::error_code ec;
+        {
+            auto file = ufmt::rotating_text_file::open((directory / "log").string(), ec,
+                                                       {.max_size = 10});
+            REQUIRE(file);
+            REQUIRE_FALSE(file->error());
+            std::filesystem::remove_all(directory);
+            for(auto i = 0; i != 400 && !file->error(); ++i) {
+                REQUIRE(file->print("line ", i));
+                std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            }
+            REQUIRE_EQ(file->error(), std::errc::no_such_file_or_directory);
+        }
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/shared_text.hpp>
+
+
+TEST_SUITE("shared_text") {
+
+
+    SCENARIO("Lines from many threads land whole in one buffer") {
+        constexpr auto threads = 4;
+        constexpr auto lines = 5000;
+        ufmt::shared_text shared{1 << 20};
+        ufmt::memory_sink flushed;
+        std::error_code ec;
+
+        std::vector<std::thread> writers;
+        for(auto t = 0; t != threads; ++t)
+            writers.emplace_back([&, t] {
+                for(auto i = 0; i != lines; ++i)
+                    REQUIRE(shared.print("thread ", t, " line ", i, ' ', -127562.127562));
+            });
+        for(auto i = 0; i != 100; ++i)
+            REQUIRE(shared.flush(flushed, ec));
+        for(auto& w: writers)
+            w.join();
+        REQUIRE(shared.flush(flushed, ec));
+
+        REQUIRE_EQ(flushed.view(), shared.view());
+        std::vector<std::string> got, expected;
+        std::string line;
+        for(auto c: shared.view()) {
+            line += c;
+            if(c == '\n')
+                got.push_back(std::move(line)), line.clear();
+        }
+        REQUIRE(line.empty());
+        for(auto t = 0; t != threads; ++t)
+            for(auto i = 0; i != lines; ++i)
+                expected.push_back(ufmt::text::of("thread ", t, " line ", i, ' ', -127562.127562, '\n'));
+        std::sort(got.begin(), got.end());
+        std::sort(expected.begin(), expected.end());
+        REQUIRE_EQ(got, expected);
+    }
+
+
+    SCENARIO("Lines that do not fit are dropped and the rest stays whole") {
+        ufmt::shared_text shared{64};
+        auto fitted = 0;
+        for(auto i = 0; i != 20; ++i)
+            fitted += shared.print("line ", i) ? 1 : 0;
+        REQUIRE_EQ(fitted, 9);
+        REQUIRE_EQ(shared.dropped(), 11);
+        REQUIRE_EQ(shared.view(), "line 0\nline 1\nline 2\nline 3\nline 4\nline 5\nline 6\nline 7\nline 8\n");
+
+        shared.clear();
+        REQUIRE(shared.view().empty());
+        REQUIRE(shared.print("again"));
+        REQUIRE_EQ(shared.view(), "again\n");
+        REQUIRE_EQ(shared.dropped(), 0);
+    }
+
+
+    SCENARIO("Batches reuse the buffer after clear") {
+        ufmt::shared_text shared{4096};
+        for(auto batch = 0; batch != 10000; ++batch) {
+            shared.clear();
+            std::vector<std::thread> workers;
+            if(batch % 1000 == 0)
+                for(auto t = 0; t != 2; ++t)
+                    workers.emplace_back([&shared, t] { shared.print("thread ", t); });
+            for(auto& w: workers)
+                w.join();
+            REQUIRE(shared.print("batch ", batch));
+            REQUIRE(shared.view().ends_with(ufmt::text::of("batch ", batch, '\n')));
+        }
+    }
+
+}
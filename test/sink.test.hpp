@@ -0,0 +1,76 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/buffered_file.hpp>
+#include <ufmt/sink.hpp>
+#include <ufmt/text_file.hpp>
+
+
+static_assert(ufmt::sink<ufmt::fd_sink>);
+static_assert(ufmt::sink<ufmt::null_sink>);
+static_assert(ufmt::sink<ufmt::text_file<>>);
+static_assert(ufmt::sink<ufmt::buffered_file<>>);
+static_assert(ufmt::sink<ufmt::logger<ufmt::memory_sink, ufmt::null_sink>>);
+
+
+TEST_SUITE("sink") {
+
+
+    SCENARIO("Logger formats once and writes the same line to every sink") {
+        ufmt::memory_sink first;
+        ufmt::memory_sink second;
+        ufmt::logger<ufmt::memory_sink&, ufmt::null_sink, ufmt::memory_sink&> log{
+            first, ufmt::null_sink{}, second};
+        REQUIRE(log.print("value: ", 127.562, ' ', ufmt::quoted("text")));
+        REQUIRE(log.print(-1));
+        REQUIRE_EQ(first.view(), "value: 127.562 'text'\n-1\n");
+        REQUIRE_EQ(second.view(), first.view());
+        REQUIRE_FALSE(log.error());
+    }
+
+
+    SCENARIO("Owned file and socket sinks receive the line") {
+        auto const path = std::string{"ufmt-sink.test.log"};
+        std::error_code ec;
+        auto file = ufmt::file_sink::create_always(path, ec);
+        REQUIRE(file);
+        int pair[2];
+        REQUIRE_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+
+        ufmt::logger log{std::move(*file), ufmt::socket_sink{pair[0]}};
+        REQUIRE(log.print("line ", 1));
+        log.get<0>().close();
+
+        std::ifstream in{path, std::ios::binary};
+        REQUIRE_EQ(std::string{std::istreambuf_iterator<char>{in}, {}}, "line 1\n");
+        char received[16];
+        auto const n = ::read(pair[1], received, sizeof(received));
+        REQUIRE_EQ(std::string(received, std::size_t(n)), "line 1\n");
+
+        ::close(pair[1]);
+        log.get<1>().write("gone", ec);
+        REQUIRE_EQ(ec, std::errc::broken_pipe);
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Failure of one sink does not stop the others") {
+        ufmt::memory_sink memory;
+        ufmt::logger<ufmt::fd_sink, ufmt::memory_sink&> log{ufmt::fd_sink{-1}, memory};
+        REQUIRE_FALSE(log.print("kept"));
+        REQUIRE_EQ(log.error(), std::errc::bad_file_descriptor);
+        REQUIRE_EQ(memory.view(), "kept\n");
+    }
+
+}
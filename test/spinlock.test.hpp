@@ -0,0 +1,87 @@
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+#include <ufmt/print.hpp>
+
+
+TEST_SUITE("spinlock") {
+
+
+    SCENARIO("Held lock is not acquired twice") {
+        ufmt::detail::printer::spinlock lock;
+        REQUIRE(lock.try_lock());
+        REQUIRE_FALSE(lock.try_lock());
+        lock.unlock();
+        REQUIRE(lock.try_lock());
+        lock.unlock();
+    }
+
+
+    SCENARIO("Waiter parks and is woken by unlock") {
+        ufmt::detail::printer::spinlock lock;
+        lock.lock();
+        std::atomic<bool> acquired{false};
+        std::thread waiter{[&] {
+            lock.lock();
+            acquired.store(true);
+            lock.unlock();
+        }};
+        // longer than the spin and yield phases, the waiter sleeps on the futex
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        REQUIRE_FALSE(acquired.load());
+        lock.unlock();
+        waiter.join();
+        REQUIRE(acquired.load());
+        REQUIRE(lock.try_lock());
+        lock.unlock();
+
+        auto const statistics = lock.statistics();
+#if defined(UFMT_LOCK_STATISTICS)
+        REQUIRE_EQ(statistics.acquisitions, 3);
+        REQUIRE_EQ(statistics.contended, 1);
+        REQUIRE_GE(statistics.wait_time, std::chrono::milliseconds{40});
+#else
+        REQUIRE_EQ(statistics.acquisitions, 0);
+        REQUIRE_EQ(statistics.contended, 0);
+#endif
+    }
+
+
+    SCENARIO("Contended lock excludes and counts every acquisition") {
+        constexpr auto threads = 8;
+        constexpr auto locks_per_thread = 20000;
+        ufmt::detail::printer::spinlock lock;
+        auto counter = 0;
+        std::vector<std::thread> workers;
+        for(auto t = 0; t != threads; ++t)
+            workers.emplace_back([&] {
+                for(auto i = 0; i != locks_per_thread; ++i) {
+                    std::unique_lock g{lock};
+                    ++counter;
+                    if(i % 1000 == 0)
+                        std::this_thread::yield();   // let the others contend
+                }
+            });
+        for(auto& worker: workers)
+            worker.join();
+        REQUIRE_EQ(counter, threads * locks_per_thread);
+
+        auto const statistics = lock.statistics();
+#if defined(UFMT_LOCK_STATISTICS)
+        REQUIRE_EQ(statistics.acquisitions, std::uint64_t(threads * locks_per_thread));
+        REQUIRE_GT(statistics.contended, 0);
+        REQUIRE_LE(statistics.contended, statistics.acquisitions);
+#else
+        REQUIRE_EQ(statistics.acquisitions, 0);
+#endif
+    }
+
+}
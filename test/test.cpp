@@ -2,6 +2,30 @@
 #include "doctest.h"
 
 
+#include "async_print.test.hpp"
+#include "binary.test.hpp"
+#include "buffered_file.test.hpp"
+#include "datagram_sink.test.hpp"
+#include "deferred.test.hpp"
+#include "direct_text_file.test.hpp"
+#include "durable_text_file.test.hpp"
 #include "fixed_string.test.hpp"
+#include "flight_recorder.test.hpp"
 #include "json.test.hpp"
+#include "log.test.hpp"
+#include "mapped_text_file.test.hpp"
+#include "memfd_sink.test.hpp"
+#include "ordered_print.test.hpp"
+#include "parallel_text_file.test.hpp"
+#include "pipe_printer.test.hpp"
+#include "print.test.hpp"
+#include "printer.test.hpp"
+#include "rate_limit.test.hpp"
+#include "rotating_text_file.test.hpp"
+#include "shared_text.test.hpp"
+#include "sink.test.hpp"
+#include "spinlock.test.hpp"
 #include "text.test.hpp"
+#include "text_pool.test.hpp"
+#include "text_file.test.hpp"
+#include "uring_text_file.test.hpp"
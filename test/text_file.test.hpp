@@ -0,0 +1,70 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.h"
+
+#include <ufmt/print.hpp>
+#include <ufmt/text_file.hpp>
+
+
+TEST_SUITE("text_file") {
+
+
+    SCENARIO("Texts beyond IOV_MAX are written in order") {
+        auto const path = std::string{"ufmt-text_file.test.log"};
+        std::error_code ec;
+        std::string expected;
+        {
+            auto file = ufmt::text_file<>::create_always(path, ec);
+            REQUIRE(file);
+            REQUIRE(file->write("header\n", ec));
+            expected += "header\n";
+
+            std::vector<ufmt::text> records(3000);
+            std::vector<ufmt::text const*> batch;
+            for(auto i = 0; i != 3000; ++i) {
+                records[i].format("record ", i, '\n');
+                expected += ufmt::text::of("record ", i, '\n');
+                batch.push_back(&records[i]);
+            }
+            REQUIRE(file->write_all(batch, ec));
+        }
+        std::ifstream in{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{in}, {}};
+        REQUIRE_EQ(content, expected);
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Batch is printed to stdout at once") {
+        auto* file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        ufmt::text header, record;
+        header.format("header\n");
+        record.format("record ", 1, '\n');
+        ufmt::text const* batch[] = {&header, &record, &record};
+        auto const saved = ::dup(1);
+        ::dup2(fileno(file), 1);
+        ufmt::output_redirected();
+        ufmt::print_all(batch);
+        ::dup2(saved, 1);
+        ::close(saved);
+        ufmt::output_redirected();
+
+        std::rewind(file);
+        char content[64] = {};
+        auto const n = std::fread(content, 1, sizeof(content) - 1, file);
+        std::fclose(file);
+        REQUIRE_EQ(std::string(content, n), "header\nrecord 1\nrecord 1\n");
+    }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "doctest.h"
+
+#include <ufmt/text_pool.hpp>
+
+
+TEST_SUITE("text_pool") {
+
+
+    SCENARIO("Released texts are reused with their capacity") {
+        ufmt::text_pool<> pool{1, 256};
+        REQUIRE_EQ(pool.allocated(), 1);
+        auto handle = pool.acquire();
+        REQUIRE(handle);
+        REQUIRE_GE(handle->capacity(), 256);
+        handle->format("value: ", 127.562);
+        REQUIRE_EQ(handle->view(), "value: 127.562");
+        auto const* data = handle->data();
+
+        auto moved = std::move(handle);
+        REQUIRE_FALSE(handle);
+        moved.reset();
+        REQUIRE_FALSE(moved);
+
+        auto again = pool.acquire();
+        REQUIRE(again->empty());
+        REQUIRE_EQ(again->data(), data);
+        auto second = pool.acquire();
+        REQUIRE_EQ(pool.allocated(), 2);
+    }
+
+
+    SCENARIO("Texts passed to another thread come back to the producer") {
+        constexpr auto messages = 20000;
+        constexpr auto bound = 8u;
+        ufmt::text_pool<> pool;
+        std::mutex sync;
+        std::condition_variable changed;
+        std::deque<ufmt::text_handle<>> queue;
+        std::set<char const*> buffers;
+
+        std::thread consumer{[&] {
+            for(auto i = 0; i != messages; ++i) {
+                ufmt::text_handle<> h;
+                {
+                    std::unique_lock g{sync};
+                    changed.wait(g, [&] { return !queue.empty(); });
+                    h = std::move(queue.front());
+                    queue.pop_front();
+                }
+                changed.notify_all();
+                REQUIRE_EQ(h->view(), ufmt::text::of("message ", i));
+            }
+        }};
+
+        for(auto i = 0; i != messages; ++i) {
+            auto h = pool.acquire();
+            h->format("message ", i);
+            if(i >= messages / 2)
+                buffers.insert(h->data());
+            std::unique_lock g{sync};
+            changed.wait(g, [&] { return queue.size() < bound; });
+            queue.push_back(std::move(h));
+            changed.notify_all();
+        }
+        consumer.join();
+
+        REQUIRE_LE(pool.allocated(), bound + 2);
+        REQUIRE_LE(buffers.size(), pool.allocated());
+    }
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include "doctest.h"
+
+#include <ufmt/uring_text_file.hpp>
+
+
+TEST_SUITE("uring_text_file") {
+
+
+    SCENARIO("Lines rotate through buffers in file order") {
+        // io_uring may be blocked (seccomp, kernel.io_uring_disabled), the
+        // file then writes with write(2) and only the content is checked
+        ufmt::detail::uring::ring probe;
+        std::error_code unavailable;
+        auto const available = probe.open(4, unavailable);
+        probe.close();
+        for(auto fallback: {false, true}) {
+            auto const path = std::string{"ufmt-uring_text_file.test.log"};
+            std::error_code ec;
+            std::string expected;
+            {
+                auto file = ufmt::uring_text_file<>::create_always(
+                    path, ec, {.buffers = 3, .buffer_size = 512, .fallback = fallback});
+                REQUIRE(file);
+                if(fallback || available)
+                    REQUIRE_EQ(file->uring(), !fallback);
+                for(auto i = 0; i != 5000; ++i) {
+                    file->print("line ", i, ", value ", -127562.127562);
+                    expected += ufmt::text::of("line ", i, ", value ", -127562.127562, '\n');
+                }
+                file->write(std::string(2000, '*'));
+                expected += std::string(2000, '*');
+                REQUIRE(file->flush());
+                file->print("last");
+                expected += "last\n";
+            }
+            std::ifstream in{path, std::ios::binary};
+            std::string const content{std::istreambuf_iterator<char>{in}, {}};
+            REQUIRE_EQ(content, expected);
+            std::remove(path.data());
+        }
+    }
+
+
+    SCENARIO("Buffers grown past their registration are written") {
+        auto const path = std::string{"ufmt-uring_text_file-grown.test.log"};
+        std::error_code ec;
+        std::string expected;
+        {
+            auto file = ufmt::uring_text_file<>::create_always(
+                path, ec, {.buffers = 2, .buffer_size = 4096});
+            REQUIRE(file);
+            for(auto size: {100000, 10, 300000, 20, 5000}) {
+                std::string const line(std::size_t(size), char('a' + size % 26));
+                REQUIRE(file->write(line));
+                expected += line;
+                file->print(" line ", size);
+                expected += ufmt::text::of(" line ", size, '\n');
+            }
+            REQUIRE(file->flush());
+            REQUIRE_FALSE(file->error());
+        }
+        std::ifstream in{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{in}, {}};
+        REQUIRE_EQ(content, expected);
+        std::remove(path.data());
+    }
+
+
+    SCENARIO("Append continues after existing content") {
+        auto const path = std::string{"ufmt-uring_text_file-append.test.log"};
+        std::error_code ec;
+        {
+            auto file = ufmt::uring_text_file<>::create_always(path, ec);
+            REQUIRE(file);
+            file->print("first");
+        }
+        {
+            auto file = ufmt::uring_text_file<>::open_always_to_append(path, ec);
+            REQUIRE(file);
+            auto moved = std::move(*file);
+            moved.print("second");
+        }
+        std::ifstream in{path, std::ios::binary};
+        std::string const content{std::istreambuf_iterator<char>{in}, {}};
+        REQUIRE_EQ(content, "first\nsecond\n");
+        std::remove(path.data());
+    }
+
+}
@@ -0,0 +1,34 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include <ufmt/binary.hpp>
+
+
+int main(int argc, char* argv[]) {
+    if(argc != 2) {
+        std::fprintf(stderr, "usage: %s <binary log>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream file{argv[1], std::ios::binary};
+    if(!file) {
+        std::fprintf(stderr, "unable to open '%s'\n", argv[1]);
+        return 1;
+    }
+    std::string const content{std::istreambuf_iterator<char>{file}, {}};
+
+    ufmt::text decoded;
+    auto const ok = ufmt::decode_binary_log(content, decoded);
+    std::error_code ec;
+    ufmt::detail::io::write_all(1, decoded.data(), decoded.size(), ec);
+    if(!ok) {
+        std::fprintf(stderr, "'%s' is malformed\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
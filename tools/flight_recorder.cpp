@@ -0,0 +1,34 @@
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <system_error>
+
+#include <ufmt/flight_recorder.hpp>
+#include <ufmt/io.hpp>
+
+
+int main(int argc, char* argv[]) {
+    if(argc != 2) {
+        std::fprintf(stderr, "usage: %s <shared memory name>\n", argv[0]);
+        return 1;
+    }
+
+    ufmt::text dumped;
+    std::uint64_t first = 0, last = 0;
+    std::error_code ec;
+    auto const ok = ufmt::read_flight_recorder(argv[1], ec,
+        [&](std::uint64_t sequence, std::string_view record) {
+            if(first == 0)
+                first = sequence;
+            last = sequence;
+            dumped.append(record.data(), record.size());
+        });
+    if(!ok) {
+        std::fprintf(stderr, "unable to read '%s': %s\n", argv[1], ec.message().data());
+        return 1;
+    }
+    ufmt::detail::io::write_all(1, dumped.data(), dumped.size(), ec);
+    std::fprintf(stderr, "records %llu..%llu\n", (unsigned long long)first,
+                 (unsigned long long)last);
+    return 0;
+}